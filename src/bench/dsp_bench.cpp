@@ -0,0 +1,246 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "dsp_bench.h"
+#include "../dsp/dsp_kernels.h"
+
+#define FIR_TAPS 16
+
+// The firmware's pressure calibration: bar = a * counts + b
+#define CAL_GAIN 3.9628e-6f
+#define CAL_OFFSET -4.9509f
+
+// Float kernels may differ from the reference in the last bits (the
+// assembly fuses multiply-adds), integer kernels must match exactly
+#define FLOAT_TOLERANCE 1e-5f
+
+static DspBenchPrint output;
+static DspBenchClock now;
+static bool allPassed;
+
+static void report(const char *name, uint32_t kernelUs, uint32_t referenceUs, float maxError, bool passed) {
+    char line[96];
+    float perBlockKernel = float(kernelUs) / DSP_BENCH_ROUNDS;
+    float perBlockReference = float(referenceUs) / DSP_BENCH_ROUNDS;
+    snprintf(line, sizeof(line), "%-16s %9.2f %9.2f %6.2fx  err %-10.3g %s",
+             name, perBlockKernel, perBlockReference,
+             kernelUs > 0 ? float(referenceUs) / float(kernelUs) : 0.0f,
+             maxError, passed ? "ok" : "MISMATCH");
+    output(line);
+    allPassed = allPassed && passed;
+}
+
+static void check(const char *name, bool passed) {
+    if (!passed) {
+        char line[64];
+        snprintf(line, sizeof(line), "%-16s known-answer check FAILED", name);
+        output(line);
+        allPassed = false;
+    }
+}
+
+static float relativeError(const float *a, const float *b, size_t count) {
+    float worst = 0;
+    for (size_t i = 0; i < count; i++) {
+        float error = fabsf(a[i] - b[i]) / (fabsf(b[i]) + 1.0f);
+        worst = error > worst ? error : worst;
+    }
+    return worst;
+}
+
+// A shot-like pressure trace in mbar with a little deterministic noise
+static void makeSignal(float *signal, int16_t *mbar, uint8_t *raw, size_t count) {
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1664525 + 1013904223;
+        float noise = float(int32_t(seed >> 16) % 101 - 50);
+        float t = float(i) / float(count);
+        float pressure = t < 0.3f ? 30000 * t : 9000 - 2000 * (t - 0.3f);
+        signal[i] = pressure + noise;
+        mbar[i] = int16_t(signal[i]);
+
+        int32_t counts = int32_t((signal[i] / 1000 - CAL_OFFSET) / CAL_GAIN);
+        raw[i * 3] = uint8_t(counts >> 16);
+        raw[i * 3 + 1] = uint8_t(counts >> 8);
+        raw[i * 3 + 2] = uint8_t(counts);
+    }
+}
+
+static void benchFir(const float *signal) {
+    static float coeffs[FIR_TAPS];
+    static float delayKernel[FIR_TAPS];
+    static float delayReference[FIR_TAPS];
+    static float outKernel[DSP_BENCH_BLOCK];
+    static float outReference[DSP_BENCH_BLOCK];
+
+    // Hann-windowed moving average: symmetric, unity DC gain
+    float sum = 0;
+    for (int i = 0; i < FIR_TAPS / 2; i++) {
+        coeffs[i] = 0.5f - 0.5f * cosf(2 * float(M_PI) * (i + 1) / (FIR_TAPS + 1));
+        coeffs[FIR_TAPS - 1 - i] = coeffs[i];
+        sum += 2 * coeffs[i];
+    }
+    for (int i = 0; i < FIR_TAPS; i++) {
+        coeffs[i] /= sum;
+    }
+
+    DspFir kernel;
+    DspFir reference;
+
+    // Impulse response of a symmetric filter is its taps
+    dspFirInit(reference, coeffs, delayReference, FIR_TAPS);
+    float impulse[FIR_TAPS] = { 1 };
+    dspFirF32Ref(reference, impulse, outReference, FIR_TAPS);
+    check("fir", memcmp(outReference, coeffs, sizeof(coeffs)) == 0);
+
+    dspFirInit(kernel, coeffs, delayKernel, FIR_TAPS);
+    dspFirInit(reference, coeffs, delayReference, FIR_TAPS);
+    float maxError = 0;
+    uint32_t kernelUs = 0;
+    uint32_t referenceUs = 0;
+    for (int round = 0; round < DSP_BENCH_ROUNDS; round++) {
+        uint32_t start = now();
+        dspFirF32(kernel, signal, outKernel, DSP_BENCH_BLOCK);
+        uint32_t middle = now();
+        dspFirF32Ref(reference, signal, outReference, DSP_BENCH_BLOCK);
+        referenceUs += now() - middle;
+        kernelUs += middle - start;
+
+        float error = relativeError(outKernel, outReference, DSP_BENCH_BLOCK);
+        maxError = error > maxError ? error : maxError;
+    }
+    report("fir_f32 16", kernelUs, referenceUs, maxError, maxError <= FLOAT_TOLERANCE);
+}
+
+static void benchBiquad(const float *signal) {
+    static float outKernel[DSP_BENCH_BLOCK];
+    static float outReference[DSP_BENCH_BLOCK];
+    float coef[5];
+    dspBiquadLowpass(coef, 0.05f, 0.7071f);
+
+    // Unity gain at DC once settled
+    float stateCheck[2] = { 0, 0 };
+    float one[DSP_BENCH_BLOCK];
+    for (int i = 0; i < DSP_BENCH_BLOCK; i++) {
+        one[i] = 1;
+    }
+    dspBiquadF32Ref(one, outReference, DSP_BENCH_BLOCK, coef, stateCheck);
+    check("biquad", fabsf(outReference[DSP_BENCH_BLOCK - 1] - 1) < 1e-4f);
+
+    float stateKernel[2] = { 0, 0 };
+    float stateReference[2] = { 0, 0 };
+    float maxError = 0;
+    uint32_t kernelUs = 0;
+    uint32_t referenceUs = 0;
+    for (int round = 0; round < DSP_BENCH_ROUNDS; round++) {
+        uint32_t start = now();
+        dspBiquadF32(signal, outKernel, DSP_BENCH_BLOCK, coef, stateKernel);
+        uint32_t middle = now();
+        dspBiquadF32Ref(signal, outReference, DSP_BENCH_BLOCK, coef, stateReference);
+        referenceUs += now() - middle;
+        kernelUs += middle - start;
+
+        float error = relativeError(outKernel, outReference, DSP_BENCH_BLOCK);
+        maxError = error > maxError ? error : maxError;
+    }
+    report("biquad_f32", kernelUs, referenceUs, maxError, maxError <= FLOAT_TOLERANCE);
+}
+
+// Reference: the obvious per-group scan
+static void benchMinMax(const int16_t *mbar) {
+    const size_t factor = 8;
+    static int16_t minKernel[DSP_BENCH_BLOCK];
+    static int16_t maxKernel[DSP_BENCH_BLOCK];
+    static int16_t minReference[DSP_BENCH_BLOCK];
+    static int16_t maxReference[DSP_BENCH_BLOCK];
+
+    size_t outputs = 0;
+    uint32_t kernelUs = 0;
+    uint32_t referenceUs = 0;
+    for (int round = 0; round < DSP_BENCH_ROUNDS; round++) {
+        uint32_t start = now();
+        outputs = dspMinMaxDecimate(mbar, DSP_BENCH_BLOCK - 3, factor, minKernel, maxKernel);
+        uint32_t middle = now();
+        for (size_t group = 0; group * factor < DSP_BENCH_BLOCK - 3; group++) {
+            minReference[group] = INT16_MAX;
+            maxReference[group] = INT16_MIN;
+            for (size_t i = group * factor; i < (group + 1) * factor && i < DSP_BENCH_BLOCK - 3; i++) {
+                if (mbar[i] < minReference[group]) {
+                    minReference[group] = mbar[i];
+                }
+                if (mbar[i] > maxReference[group]) {
+                    maxReference[group] = mbar[i];
+                }
+            }
+        }
+        referenceUs += now() - middle;
+        kernelUs += middle - start;
+    }
+
+    // 253 samples: the short last group must come out too
+    bool passed = outputs == (DSP_BENCH_BLOCK - 3 + factor - 1) / factor
+        && memcmp(minKernel, minReference, outputs * sizeof(int16_t)) == 0
+        && memcmp(maxKernel, maxReference, outputs * sizeof(int16_t)) == 0;
+    report("minmax /8", kernelUs, referenceUs, 0, passed);
+}
+
+// Reference: the float calibration PressureSensor used per reading
+static void benchInt24(const uint8_t *raw) {
+    static int16_t outKernel[DSP_BENCH_BLOCK];
+    static int16_t outReference[DSP_BENCH_BLOCK];
+
+    const uint8_t known[] = { 0x80, 0x00, 0x00, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x01 };
+    int32_t unpacked[4];
+    dspInt24ToInt32(known, 4, unpacked);
+    check("int24", unpacked[0] == -8388608 && unpacked[1] == 8388607 && unpacked[2] == -1 && unpacked[3] == 1);
+
+    DspFixedScale scale = dspFixedScale(CAL_GAIN * 1000, CAL_OFFSET * 1000);
+    float maxError = 0;
+    uint32_t kernelUs = 0;
+    uint32_t referenceUs = 0;
+    for (int round = 0; round < DSP_BENCH_ROUNDS; round++) {
+        uint32_t start = now();
+        dspInt24ToFixed(raw, DSP_BENCH_BLOCK, scale, outKernel);
+        uint32_t middle = now();
+        for (size_t i = 0; i < DSP_BENCH_BLOCK; i++) {
+            uint32_t dat = (raw[i * 3] << 16) | (raw[i * 3 + 1] << 8) | raw[i * 3 + 2];
+            float fadc = (dat & 0x800000) ? dat - 16777216.0f : float(dat);
+            outReference[i] = int16_t(lroundf((CAL_GAIN * fadc + CAL_OFFSET) * 1000));
+        }
+        referenceUs += now() - middle;
+        kernelUs += middle - start;
+    }
+
+    // The float path rounds twice through a 24-bit mantissa, allow 1 mbar
+    for (size_t i = 0; i < DSP_BENCH_BLOCK; i++) {
+        float error = fabsf(float(outKernel[i] - outReference[i]));
+        maxError = error > maxError ? error : maxError;
+    }
+    report("int24->mbar", kernelUs, referenceUs, maxError, maxError <= 1);
+}
+
+bool runDspBench(DspBenchPrint print, DspBenchClock clock) {
+    static float signal[DSP_BENCH_BLOCK];
+    static int16_t mbar[DSP_BENCH_BLOCK];
+    static uint8_t raw[DSP_BENCH_BLOCK * 3];
+
+    output = print;
+    now = clock;
+    allPassed = true;
+
+    char line[96];
+    snprintf(line, sizeof(line), "dsp bench: %d samples x %d rounds, esp-dsp %s",
+             DSP_BENCH_BLOCK, DSP_BENCH_ROUNDS, DSP_USE_ESP_DSP ? "on" : "off (reference only)");
+    output(line);
+    snprintf(line, sizeof(line), "%-16s %9s %9s %7s", "kernel", "us/blk", "ref", "speedup");
+    output(line);
+
+    makeSignal(signal, mbar, raw, DSP_BENCH_BLOCK);
+    benchFir(signal);
+    benchBiquad(signal);
+    benchMinMax(mbar);
+    benchInt24(raw);
+
+    output(allPassed ? "dsp bench: all kernels match" : "dsp bench: MISMATCH");
+    return allPassed;
+}
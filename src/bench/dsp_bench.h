@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+//
+// Times every dsp_kernels routine against its reference and checks they
+// agree. Portable: the firmware bench env and tools/dsp_bench both call it.
+//
+
+typedef void (*DspBenchPrint)(const char *line);
+typedef uint32_t (*DspBenchClock)();   // free-running microseconds
+
+#define DSP_BENCH_BLOCK 256
+#define DSP_BENCH_ROUNDS 200
+
+// False if any kernel disagrees with its reference
+bool runDspBench(DspBenchPrint print, DspBenchClock clock);
@@ -0,0 +1,24 @@
+#include <Arduino.h>
+#include "dsp_bench.h"
+
+//
+// Entry point of the dsp-bench env: pio run -e dsp-bench -t upload -t monitor
+//
+
+static void printLine(const char *line) {
+    Serial.println(line);
+}
+
+static uint32_t clockMicros() {
+    return micros();
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(500);
+}
+
+void loop() {
+    runDspBench(printLine, clockMicros);
+    delay(10000);
+}
@@ -0,0 +1,49 @@
+#include <BLE2902.h>
+#include <Arduino.h>
+#include "BLEChannels.h"
+
+BLECharacteristic ChannelsCharacteristic(
+        BLE_CHANNELS_CHARACTERISTIC,
+        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY);
+BLEDescriptor ChannelsDescriptor(BLE_CHANNELS_DESCRIPTOR);
+
+BLEChannels::BLEChannels(BLEClients *clients) {
+    this->_clients = clients;
+}
+
+void BLEChannels::registerWithServer(BLEServer *pServer) {
+    auto channelsService = pServer->createService(BLE_CHANNELS_SERVICE);
+    ChannelsDescriptor.setValue("notify: time u32, count u8, {age u8, int16} per channel");
+    channelsService->addCharacteristic(&ChannelsCharacteristic);
+    ChannelsCharacteristic.addDescriptor(&ChannelsDescriptor);
+    auto channelsCccd = new BLE2902();
+    ChannelsCharacteristic.addDescriptor(channelsCccd);
+    channelsService->start();
+
+    _stream = _clients->track(&ChannelsCharacteristic, channelsCccd);
+}
+
+void BLEChannels::publish(const SensorSample *samples, uint8_t count) {
+    uint8_t packet[BLE_CHANNELS_PACKET_LEN];
+    count = min(count, (uint8_t) SENSOR_MAX_CHANNELS);
+
+    uint32_t baseTime = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        baseTime = max(baseTime, samples[i].time);
+    }
+
+    memcpy(packet, &baseTime, sizeof(baseTime));
+    packet[4] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t *entry = packet + 5 + 3 * i;
+        entry[0] = uint8_t(min(baseTime - samples[i].time, (uint32_t) 255));
+        memcpy(entry + 1, &samples[i].value, sizeof(int16_t));
+    }
+
+    ChannelsCharacteristic.setValue(packet, 5 + 3 * count);
+    _clients->publish(_stream, packet, 5 + 3 * count);
+}
+
+bool BLEChannels::hasSubscribers() const {
+    return _clients->subscribedCount(_stream) > 0;
+}
@@ -0,0 +1,34 @@
+#ifndef BLECHANNELS_H
+#define BLECHANNELS_H
+
+#include <BLEServer.h>
+#include <BLEUtils.h>
+#include "../sensors/sensor_bus.h"
+#include "BLEClients.h"
+
+#define BLE_CHANNELS_SERVICE BLEUUID("6d7c0f12-3b7e-4c8e-9a51-0c5f3e2a7b01")
+#define BLE_CHANNELS_CHARACTERISTIC BLEUUID("6d7c0f13-3b7e-4c8e-9a51-0c5f3e2a7b01")
+#define BLE_CHANNELS_DESCRIPTOR BLEUUID((uint16_t) ESP_GATT_UUID_CHAR_DESCRIPTION)
+
+// [base time ms u32][count u8] then per channel [age ms u8][value int16], all LE;
+// 17 bytes for four channels fits the default 20 byte notification
+#define BLE_CHANNELS_PACKET_LEN (5 + 3 * SENSOR_MAX_CHANNELS)
+
+//
+// All sensor channels multiplexed into one notify characteristic. The OEP
+// pressure characteristic keeps carrying channel 0 for existing apps. Both
+// go through BLEClients, with their own per-client subscription and queue.
+//
+class BLEChannels {
+public:
+    explicit BLEChannels(BLEClients *clients);
+    void registerWithServer(BLEServer *pServer);
+    void publish(const SensorSample *samples, uint8_t count);
+    bool hasSubscribers() const;
+
+private:
+    BLEClients *_clients;
+    int8_t _stream = -1;
+};
+
+#endif //BLECHANNELS_H
@@ -0,0 +1,310 @@
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <esp_gap_ble_api.h>
+#include <esp_gatts_api.h>
+
+#include "BLEClients.h"
+
+BLEClients *BLEClients::_instance = nullptr;
+
+BLEClients::BLEClients(uint16_t samplePeriodMs) {
+    this->_samplePeriodMs = samplePeriodMs > 0 ? samplePeriodMs : 1;
+}
+
+void BLEClients::attach(BLEServer *pServer) {
+    // Raw GATTS/GAP events are the only place that carry the connection id
+    // of a CCCD write and the interval the central actually granted
+    _instance = this;
+    _pServer = pServer;
+    pServer->setCallbacks(this);
+    BLEDevice::setCustomGattsHandler(BLEClients::gattsHandler);
+    BLEDevice::setCustomGapHandler(BLEClients::gapHandler);
+}
+
+int8_t BLEClients::track(BLECharacteristic *characteristic, BLEDescriptor *cccd) {
+    if (_streamCount >= BLE_MAX_STREAMS) {
+        return -1;
+    }
+    _characteristics[_streamCount] = characteristic;
+    _cccds[_streamCount] = cccd;
+    return _streamCount++;
+}
+
+void BLEClients::setSamplePeriod(uint16_t samplePeriodMs) {
+    portENTER_CRITICAL(&_lock);
+    _samplePeriodMs = samplePeriodMs > 0 ? samplePeriodMs : 1;
+    for (auto &client : _clients) {
+        if (client.connected) {
+            updateDecimation(client);
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+void BLEClients::publish(int8_t stream, const uint8_t *data, uint8_t length) {
+    if (stream < 0 || stream >= _streamCount) {
+        return;
+    }
+    length = min(length, (uint8_t) BLE_PACKET_LEN);
+
+    portENTER_CRITICAL(&_lock);
+    for (auto &client : _clients) {
+        BLEStreamState &state = client.streams[stream];
+        if (!client.connected || !state.subscribed) {
+            continue;
+        }
+        if (state.decimationCounter == 0) {
+            enqueue(state, data, length);
+        }
+        state.decimationCounter = (state.decimationCounter + 1) % client.decimation;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    flush();
+}
+
+uint8_t BLEClients::connectedCount() const {
+    uint8_t count = 0;
+    portENTER_CRITICAL(&_lock);
+    for (const auto &client : _clients) {
+        count += client.connected ? 1 : 0;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return count;
+}
+
+uint8_t BLEClients::subscribedCount(int8_t stream) const {
+    if (stream < 0 || stream >= _streamCount) {
+        return 0;
+    }
+    uint8_t count = 0;
+    portENTER_CRITICAL(&_lock);
+    for (const auto &client : _clients) {
+        count += (client.connected && client.streams[stream].subscribed) ? 1 : 0;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return count;
+}
+
+BLEClientState BLEClients::getClient(uint8_t index) const {
+    BLEClientState client = {};
+    if (index < BLE_MAX_CLIENTS) {
+        portENTER_CRITICAL(&_lock);
+        client = _clients[index];
+        portEXIT_CRITICAL(&_lock);
+    }
+    return client;
+}
+
+void BLEClients::onConnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) {
+    bool accepted = false;
+    uint8_t connected = 0;
+
+    portENTER_CRITICAL(&_lock);
+    for (auto &client : _clients) {
+        if (!client.connected && !accepted) {
+            client = {};
+            client.connected = true;
+            client.connId = param->connect.conn_id;
+            memcpy(client.address, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+            client.decimation = 1;
+            accepted = true;
+        }
+        connected += client.connected ? 1 : 0;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (!accepted) {
+        Serial.printf("BLE: no free client slot for conn %d\r\n", param->connect.conn_id);
+        pServer->disconnect(param->connect.conn_id);
+        return;
+    }
+
+    Serial.printf("BLE: client %d connected (%d total)\r\n", param->connect.conn_id, connected);
+
+    // Ask for a fast link; whatever the central grants comes back as a GAP event
+    pServer->updateConnParams(param->connect.remote_bda,
+                              BLE_PREFERRED_MIN_INTERVAL, BLE_PREFERRED_MAX_INTERVAL,
+                              0, BLE_SUPERVISION_TIMEOUT);
+
+    // Advertising stops on every connection, keep it going while slots remain
+    if (connected < BLE_MAX_CLIENTS) {
+        pServer->startAdvertising();
+    }
+}
+
+void BLEClients::onDisconnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) {
+    portENTER_CRITICAL(&_lock);
+    BLEClientState *client = findClient(param->disconnect.conn_id);
+    if (client != nullptr) {
+        *client = {};
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    Serial.printf("BLE: client %d disconnected\r\n", param->disconnect.conn_id);
+    pServer->startAdvertising();
+}
+
+void BLEClients::gattsHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t *param) {
+    BLEClients *self = _instance;
+    if (self == nullptr) {
+        return;
+    }
+
+    if (gattsIf != ESP_GATT_IF_NONE) {
+        self->_gattsIf = gattsIf;
+    }
+
+    switch (event) {
+        case ESP_GATTS_WRITE_EVT: {
+            int8_t stream = -1;
+            for (uint8_t i = 0; i < self->_streamCount; i++) {
+                if (self->_cccds[i] != nullptr && param->write.handle == self->_cccds[i]->getHandle()) {
+                    stream = i;
+                }
+            }
+            if (stream < 0 || param->write.len < 1) {
+                break;
+            }
+            portENTER_CRITICAL(&self->_lock);
+            BLEClientState *client = self->findClient(param->write.conn_id);
+            if (client != nullptr) {
+                BLEStreamState &state = client->streams[stream];
+                state.subscribed = (param->write.value[0] & 0x01) != 0;
+                state.queueCount = 0;
+                self->updateDecimation(*client);
+            }
+            portEXIT_CRITICAL(&self->_lock);
+            break;
+        }
+        case ESP_GATTS_CONGEST_EVT: {
+            portENTER_CRITICAL(&self->_lock);
+            BLEClientState *client = self->findClient(param->congest.conn_id);
+            if (client != nullptr) {
+                client->congested = param->congest.congested;
+            }
+            portEXIT_CRITICAL(&self->_lock);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void BLEClients::gapHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
+    BLEClients *self = _instance;
+    if (self == nullptr || event != ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT) {
+        return;
+    }
+
+    portENTER_CRITICAL(&self->_lock);
+    for (auto &client : self->_clients) {
+        if (client.connected && memcmp(client.address, param->update_conn_params.bda, sizeof(esp_bd_addr_t)) == 0) {
+            client.connInterval = param->update_conn_params.conn_int;
+            self->updateDecimation(client);
+        }
+    }
+    portEXIT_CRITICAL(&self->_lock);
+}
+
+// Caller holds _lock
+BLEClientState *BLEClients::findClient(uint16_t connId) {
+    for (auto &client : _clients) {
+        if (client.connected && client.connId == connId) {
+            return &client;
+        }
+    }
+    return nullptr;
+}
+
+// Caller holds _lock. One notification per connection event is what a link
+// reliably carries, so a 45 ms central on a 20 ms sample clock gets every 3rd;
+// subscribing to both streams halves that again
+void BLEClients::updateDecimation(BLEClientState &client) {
+    uint32_t subscribed = 0;
+    for (const auto &state : client.streams) {
+        subscribed += state.subscribed ? 1 : 0;
+    }
+    if (subscribed == 0) {
+        subscribed = 1;
+    }
+
+    uint32_t intervalQuarterMs = uint32_t(client.connInterval) * 5 * subscribed; // 1.25 ms = 5/4 ms
+    uint32_t periodQuarterMs = uint32_t(_samplePeriodMs) * 4;
+    uint32_t decimation = (intervalQuarterMs + periodQuarterMs - 1) / periodQuarterMs;
+    client.decimation = uint8_t(constrain(decimation, 1u, 255u));
+    for (auto &state : client.streams) {
+        state.decimationCounter = 0;
+    }
+}
+
+// Caller holds _lock. A full queue keeps its oldest entries and overwrites the
+// newest one, so a stalled link resumes with the latest reading
+void BLEClients::enqueue(BLEStreamState &state, const uint8_t *data, uint8_t length) {
+    uint8_t slot;
+    if (state.queueCount == BLE_CLIENT_QUEUE_LEN) {
+        slot = (state.queueHead + state.queueCount - 1) % BLE_CLIENT_QUEUE_LEN;
+        state.coalesced++;
+    } else {
+        slot = (state.queueHead + state.queueCount) % BLE_CLIENT_QUEUE_LEN;
+        state.queueCount++;
+    }
+    state.queue[slot].length = length;
+    memcpy(state.queue[slot].data, data, length);
+}
+
+// ESP_ERR_NOT_FOUND when there is nothing this stream may send right now
+esp_err_t BLEClients::sendNext(BLEClientState &client, uint8_t stream) {
+    BLEStreamState &state = client.streams[stream];
+    uint16_t connId;
+    BLEPacket packet;
+
+    portENTER_CRITICAL(&_lock);
+    bool ready = client.connected && state.subscribed && !client.congested && state.queueCount > 0;
+    if (ready) {
+        connId = client.connId;
+        packet = state.queue[state.queueHead];
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (!ready) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Never wait on the stack: a refused notification stays queued and is
+    // retried on the next publish
+    esp_err_t err = esp_ble_gatts_send_indicate(_gattsIf, connId, _characteristics[stream]->getHandle(),
+                                                packet.length, packet.data, false);
+
+    portENTER_CRITICAL(&_lock);
+    if (err == ESP_OK && client.connected && client.connId == connId && state.queueCount > 0) {
+        state.queueHead = (state.queueHead + 1) % BLE_CLIENT_QUEUE_LEN;
+        state.queueCount--;
+        state.sent++;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return err;
+}
+
+// Streams take turns so a busy one cannot starve the other on a slow link
+void BLEClients::flush() {
+    if (_streamCount == 0 || _gattsIf == ESP_GATT_IF_NONE) {
+        return;
+    }
+
+    for (auto &client : _clients) {
+        bool sending = true;
+        while (sending) {
+            sending = false;
+            for (uint8_t stream = 0; stream < _streamCount; stream++) {
+                esp_err_t err = sendNext(client, stream);
+                if (err == ESP_OK) {
+                    sending = true;
+                } else if (err != ESP_ERR_NOT_FOUND) {
+                    sending = false;
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef BLECLIENTS_H
+#define BLECLIENTS_H
+
+#include <BLEServer.h>
+#include <BLEUtils.h>
+
+// Bluedroid in the Arduino core is built with three LE connections
+#define BLE_MAX_CLIENTS 3
+#define BLE_MAX_STREAMS 2
+#define BLE_CLIENT_QUEUE_LEN 8
+#define BLE_PACKET_LEN 20           // notification payload at the default ATT MTU
+
+// Connection interval we ask every central for, in 1.25 ms units (7.5..15 ms)
+#define BLE_PREFERRED_MIN_INTERVAL 6
+#define BLE_PREFERRED_MAX_INTERVAL 12
+#define BLE_SUPERVISION_TIMEOUT 400 // 10 ms units
+
+struct BLEPacket {
+    uint8_t length;
+    uint8_t data[BLE_PACKET_LEN];
+};
+
+// One tracked characteristic as seen by one client
+struct BLEStreamState {
+    bool subscribed;
+    uint8_t decimationCounter;
+    BLEPacket queue[BLE_CLIENT_QUEUE_LEN];
+    uint8_t queueHead;
+    uint8_t queueCount;
+    uint32_t sent;
+    uint32_t coalesced;
+};
+
+struct BLEClientState {
+    bool connected;
+    bool congested;
+    uint16_t connId;
+    esp_bd_addr_t address;
+    uint16_t connInterval;      // 1.25 ms units, 0 until the central reports it
+    uint8_t decimation;         // forward every Nth sample
+    BLEStreamState streams[BLE_MAX_STREAMS];
+};
+
+//
+// Tracks every connected central separately: subscription state per tracked
+// characteristic, negotiated connection interval and a bounded notification
+// queue per stream. Samples are decimated to what each link can carry and
+// coalesced instead of blocking when a link is congested, so a slow client
+// never holds back a fast one.
+//
+class BLEClients : public BLEServerCallbacks {
+public:
+    explicit BLEClients(uint16_t samplePeriodMs);
+
+    void attach(BLEServer *pServer);
+    int8_t track(BLECharacteristic *characteristic, BLEDescriptor *cccd);  // stream id, -1 when full
+    void setSamplePeriod(uint16_t samplePeriodMs);   // time between publish() calls, not the sensor rate
+
+    void publish(int8_t stream, const uint8_t *data, uint8_t length);
+
+    uint8_t connectedCount() const;
+    uint8_t subscribedCount(int8_t stream) const;
+    BLEClientState getClient(uint8_t index) const;
+
+    void onConnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) override;
+    void onDisconnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) override;
+
+private:
+    static void gattsHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t *param);
+    static void gapHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+    static BLEClients *_instance;
+
+    BLEClientState *findClient(uint16_t connId);
+    void updateDecimation(BLEClientState &client);
+    void enqueue(BLEStreamState &stream, const uint8_t *data, uint8_t length);
+    esp_err_t sendNext(BLEClientState &client, uint8_t stream);
+    void flush();
+
+    mutable portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    BLEClientState _clients[BLE_MAX_CLIENTS] = {};
+    BLEServer *_pServer = nullptr;
+    esp_gatt_if_t _gattsIf = ESP_GATT_IF_NONE;
+    BLECharacteristic *_characteristics[BLE_MAX_STREAMS] = {};
+    BLEDescriptor *_cccds[BLE_MAX_STREAMS] = {};
+    uint8_t _streamCount = 0;
+    uint16_t _samplePeriodMs;
+};
+
+#endif //BLECLIENTS_H
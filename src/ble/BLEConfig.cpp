@@ -0,0 +1,74 @@
+#include <BLE2902.h>
+#include <Arduino.h>
+#include "BLEConfig.h"
+
+//
+// Write [key] to select a setting, or [key][int32 LE] to change and persist it.
+// Read returns [key][int32 LE value][int32 LE min][int32 LE max] of the selection.
+//
+
+class ConfigCallback : public BLECharacteristicCallbacks {
+private:
+    BLEConfig *_configService;
+public:
+    explicit ConfigCallback(BLEConfig *configService) {
+        this->_configService = configService;
+    }
+
+    // Settings also change from the on-device menu, so the value is rebuilt
+    // on every read rather than only after a BLE write
+    void onRead(BLECharacteristic *pCharacteristic) override {
+        _configService->refreshValue();
+    }
+
+    void onWrite(BLECharacteristic *pCharacteristic) override {
+        _configService->handleWrite(pCharacteristic->getValue());
+    }
+};
+
+BLECharacteristic ConfigCharacteristic(
+        BLE_CONFIG_CHARACTERISTIC,
+        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE);
+BLEDescriptor ConfigDescriptor(BLE_CONFIG_DESCRIPTOR);
+
+BLEConfig::BLEConfig(ConfigRegistry *config) {
+    this->_config = config;
+}
+
+void BLEConfig::handleWrite(const std::string &value) {
+    if (value.empty() || uint8_t(value[0]) >= CONFIG_COUNT) {
+        return;
+    }
+    _selected = ConfigKey(uint8_t(value[0]));
+
+    if (value.size() >= 5) {
+        int32_t newValue;
+        memcpy(&newValue, value.data() + 1, sizeof(newValue));
+        if (_config->set(_selected, newValue)) {
+            _config->save();
+        } else {
+            Serial.printf("Config: %s rejected %d\r\n", ConfigRegistry::getEntry(_selected).key, newValue);
+        }
+    }
+
+    refreshValue();
+}
+
+void BLEConfig::refreshValue() {
+    const ConfigEntry &entry = ConfigRegistry::getEntry(_selected);
+    int32_t fields[3] = {_config->get(_selected), entry.min, entry.max};
+    uint8_t data[1 + sizeof(fields)];
+    data[0] = _selected;
+    memcpy(data + 1, fields, sizeof(fields));
+    ConfigCharacteristic.setValue(data, sizeof(data));
+}
+
+void BLEConfig::registerWithServer(BLEServer *pServer) {
+    auto configService = pServer->createService(BLE_CONFIG_SERVICE);
+    ConfigDescriptor.setValue("write: key [int32 value]; read: key value min max");
+    ConfigCharacteristic.addDescriptor(&ConfigDescriptor);
+    ConfigCharacteristic.setCallbacks(new ConfigCallback(this));
+    configService->addCharacteristic(&ConfigCharacteristic);
+    refreshValue();
+    configService->start();
+}
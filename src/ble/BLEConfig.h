@@ -0,0 +1,25 @@
+#ifndef BLECONFIG_H
+#define BLECONFIG_H
+
+#include <BLEServer.h>
+#include <BLEUtils.h>
+#include "../config/config.h"
+
+#define BLE_CONFIG_SERVICE BLEUUID("6d7c0f10-3b7e-4c8e-9a51-0c5f3e2a7b01")
+#define BLE_CONFIG_CHARACTERISTIC BLEUUID("6d7c0f11-3b7e-4c8e-9a51-0c5f3e2a7b01")
+#define BLE_CONFIG_DESCRIPTOR BLEUUID((uint16_t) ESP_GATT_UUID_CHAR_DESCRIPTION)
+
+class BLEConfig {
+private:
+    ConfigRegistry *_config;
+    ConfigKey _selected = CONFIG_REFRESH_PERIOD_MS;
+
+public:
+    explicit BLEConfig(ConfigRegistry *config);
+    void registerWithServer(BLEServer *pServer);
+
+    void handleWrite(const std::string &value);
+    void refreshValue();
+};
+
+#endif //BLECONFIG_H
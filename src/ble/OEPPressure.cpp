@@ -36,12 +36,20 @@ BLECharacteristic ZeroCharacteristic(
         BLECharacteristic::PROPERTY_WRITE);
 BLEDescriptor ZeroDescriptor(BLE_PRESSURE_ZERO_DESCRIPTOR);
 
+OEPPressure::OEPPressure(BLEClients *clients) {
+    this->_clients = clients;
+}
+
 void OEPPressure::updatePressure(int16_t newPressure) {
     this->_lastPressureReading = newPressure;
     uint16_t pressureVal = this->getReportablePresureValue();
     Serial.printf("pressureVal: %x\r\n", pressureVal);
     PressureCharacteristic.setValue(pressureVal);
-    PressureCharacteristic.notify();
+    if (this->_clients != nullptr) {
+        this->_clients->publish(this->_stream, (const uint8_t *) &pressureVal, sizeof(pressureVal));
+    } else {
+        PressureCharacteristic.notify();
+    }
     this->_updatesSent = (_updatesSent + 1) % 16;
 
     //if (this->_updatesSent == 15) {
@@ -72,7 +80,8 @@ auto pressureService = pServer->createService(BLE_PRESSURE_SERVICE);
     pressureService->addCharacteristic(&PressureCharacteristic);
     PressureDescriptor.setValue("notify: pressure followed by temperature at every 16th notification");
     PressureCharacteristic.addDescriptor(&PressureDescriptor);
-    PressureCharacteristic.addDescriptor(new BLE2902());
+    auto pressureCccd = new BLE2902();
+    PressureCharacteristic.addDescriptor(pressureCccd);
 
     ZeroDescriptor.setValue("write: any value");
     ZeroCharacteristic.addDescriptor(&ZeroDescriptor);
@@ -81,4 +90,12 @@ auto pressureService = pServer->createService(BLE_PRESSURE_SERVICE);
 
     pressureService->start();
     pServer->getAdvertising()->addServiceUUID(BLE_PRESSURE_SERVICE);
+
+    if (this->_clients != nullptr) {
+        this->_stream = this->_clients->track(&PressureCharacteristic, pressureCccd);
+    }
+}
+
+bool OEPPressure::hasSubscribers() const {
+    return this->_clients == nullptr || this->_clients->subscribedCount(this->_stream) > 0;
 }
\ No newline at end of file
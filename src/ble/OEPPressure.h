@@ -5,6 +5,7 @@
 #ifndef UNTITLED_OEPPRESSURE_H
 #define UNTITLED_OEPPRESSURE_H
 #include "BLEUtils.h"
+#include "BLEClients.h"
 
 #define BLE_PRESSURE_SERVICE BLEUUID("873ae82a-4c5a-4342-b539-9d900bf7ebd0")
 #define BLE_PRESSURE_CHARACTERISTIC "873ae82b-4c5a-4342-b539-9d900bf7ebd0"
@@ -18,12 +19,16 @@ private:
     int16_t _lastPressureReading = 0;
     uint8_t _temperature[2] = {0, 0};
     uint8_t _updatesSent = 0;
+    BLEClients *_clients = nullptr;
+    int8_t _stream = -1;
 public:
     OEPPressure() = default;
+    explicit OEPPressure(BLEClients *clients);
 
     void updatePressure(int16_t newPressure);
     void setZeroPressure();
     void registerWithServer(BLEServer *pServer);
+    bool hasSubscribers() const;
 
     uint16_t getReportablePresureValue() const;
 
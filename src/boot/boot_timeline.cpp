@@ -0,0 +1,52 @@
+#include <Arduino.h>
+#include "boot_timeline.h"
+
+BootTimeline::BootTimeline() {
+    count = 0;
+    timeToFirstSample = 0;
+}
+
+// Timestamps are micros() since app start; the ROM and second stage
+// bootloader run before that clock exists
+void BootTimeline::stage(const char *name) {
+    if (count >= BOOT_MAX_STAGES || isComplete()) {
+        return;
+    }
+    names[count] = name;
+    times[count] = micros();
+    count++;
+}
+
+void BootTimeline::firstSample() {
+    if (isComplete()) {
+        return;
+    }
+    stage("first sample");
+    timeToFirstSample = times[count - 1] / 1000;
+    if (timeToFirstSample == 0) {
+        timeToFirstSample = 1;
+    }
+    print();
+}
+
+bool BootTimeline::isComplete() {
+    return timeToFirstSample != 0;
+}
+
+uint32_t BootTimeline::getTimeToFirstSample() {
+    return timeToFirstSample;
+}
+
+void BootTimeline::print() {
+    uint32_t previous = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        Serial.printf("boot: %-14s %7.1f ms (+%.1f)\r\n", names[i], times[i] / 1000.0, (times[i] - previous) / 1000.0);
+        previous = times[i];
+    }
+
+    if (timeToFirstSample > BOOT_BUDGET_MS) {
+        Serial.printf("boot: first sample after %lu ms, over the %d ms budget\r\n", (unsigned long) timeToFirstSample, BOOT_BUDGET_MS);
+    } else {
+        Serial.printf("boot: first sample after %lu ms\r\n", (unsigned long) timeToFirstSample);
+    }
+}
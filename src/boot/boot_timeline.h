@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Target from app start to the first pressure sample on screen
+#define BOOT_BUDGET_MS 300
+#define BOOT_MAX_STAGES 12
+
+//
+// Records a timestamp per boot stage and reports them once the first sample
+// is up, so printing over Serial does not itself slow the boot down
+//
+class BootTimeline {
+  public:
+    BootTimeline();
+    void stage(const char *name);
+    void firstSample();
+    bool isComplete();
+    uint32_t getTimeToFirstSample();
+
+  private:
+    void print();
+
+    const char *names[BOOT_MAX_STAGES];
+    uint32_t times[BOOT_MAX_STAGES];
+    uint8_t count;
+    uint32_t timeToFirstSample;
+};
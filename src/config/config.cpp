@@ -0,0 +1,95 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+
+#define CONFIG_NAMESPACE "mxcoffee"
+
+// Order must follow ConfigKey
+static const ConfigEntry CONFIG_ENTRIES[CONFIG_COUNT] = {
+    { "refresh_ms",  "Sample period",   "ms",    10,   500,   5,    20 },
+    { "oversample",  "Sensor average",  "reads", 1,    8,     1,    3 },
+    { "shot_start",  "Shot start",      "mbar",  600,  3000,  100,  1000 },   // above the analyser's 500 mbar end
+    { "warn_mbar",   "Warning limit",   "mbar",  8000, 16000, 250,  12000 },
+    { "warn_ms",     "Warning horizon", "ms",    0,    3000,  100,  1000 },
+    { "yellow_mbar", "Yellow above",    "mbar",  6000, 14000, 250,  9000 },
+    { "grid_bar",    "Grid step",       "bar",   1,    5,     1,    3 },
+    { "auto_off",    "Auto-off",        "min",   1,    120,   1,    10 },
+    { "loop_budget", "Loop deadline",   "ms",    20,   1000,  10,   100 },
+    { "grinder",     "Grinder setting", "",      -1,   200,   1,    -1 },   // -1: not recorded
+    { "idle_ms",     "Idle sample",     "ms",    50,   1000,  50,   100 },
+};
+
+ConfigRegistry::ConfigRegistry() {
+    for (int i = 0; i < CONFIG_COUNT; i++) {
+        values[i].store(CONFIG_ENTRIES[i].defaultValue, std::memory_order_relaxed);
+    }
+    version.store(0);
+    savedVersion.store(0);
+}
+
+void ConfigRegistry::begin() {
+    Preferences preferences;
+    if (!preferences.begin(CONFIG_NAMESPACE, true)) {
+        Serial.println("Config: no stored settings, using defaults");
+        return;
+    }
+
+    for (int i = 0; i < CONFIG_COUNT; i++) {
+        const ConfigEntry &entry = CONFIG_ENTRIES[i];
+        int32_t value = preferences.getInt(entry.key, entry.defaultValue);
+        if (value < entry.min || value > entry.max) {
+            value = entry.defaultValue;
+        }
+        values[i].store(value, std::memory_order_relaxed);
+    }
+    preferences.end();
+
+    version.fetch_add(1, std::memory_order_release);
+    savedVersion.store(version.load());
+}
+
+bool ConfigRegistry::set(ConfigKey key, int32_t value) {
+    if (key >= CONFIG_COUNT) {
+        return false;
+    }
+
+    const ConfigEntry &entry = CONFIG_ENTRIES[key];
+    if (value < entry.min || value > entry.max) {
+        return false;
+    }
+
+    if (values[key].exchange(value, std::memory_order_relaxed) != value) {
+        version.fetch_add(1, std::memory_order_release);
+    }
+    return true;
+}
+
+void ConfigRegistry::step(ConfigKey key, int8_t direction) {
+    const ConfigEntry &entry = CONFIG_ENTRIES[key];
+    int32_t value = get(key) + direction * entry.step;
+    set(key, constrain(value, entry.min, entry.max));
+}
+
+void ConfigRegistry::save() {
+    uint32_t current = version.load(std::memory_order_acquire);
+    if (current == savedVersion.load()) {
+        return;
+    }
+
+    Preferences preferences;
+    if (!preferences.begin(CONFIG_NAMESPACE, false)) {
+        Serial.println("Config: failed to open NVS");
+        return;
+    }
+    for (int i = 0; i < CONFIG_COUNT; i++) {
+        preferences.putInt(CONFIG_ENTRIES[i].key, get(ConfigKey(i)));
+    }
+    preferences.end();
+
+    savedVersion.store(current);
+    Serial.println("Config: saved");
+}
+
+const ConfigEntry &ConfigRegistry::getEntry(ConfigKey key) {
+    return CONFIG_ENTRIES[key < CONFIG_COUNT ? key : 0];
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+//
+// Runtime configuration, persisted in NVS
+//
+
+enum ConfigKey : uint8_t {
+    CONFIG_REFRESH_PERIOD_MS,
+    CONFIG_SENSOR_OVERSAMPLING,
+    CONFIG_SHOT_START_PRESSURE,
+    CONFIG_WARN_PRESSURE,
+    CONFIG_WARN_HORIZON_MS,
+    CONFIG_YELLOW_PRESSURE,
+    CONFIG_GRID_STEP,
+    CONFIG_AUTO_OFF_MIN,
+    CONFIG_LOOP_BUDGET_MS,
+    CONFIG_GRINDER_SETTING,
+    CONFIG_IDLE_SAMPLE_MS,
+    CONFIG_COUNT
+};
+
+struct ConfigEntry {
+    const char *key;     // NVS key, max 15 chars
+    const char *label;
+    const char *unit;
+    int32_t min;
+    int32_t max;
+    int32_t step;
+    int32_t defaultValue;
+};
+
+class ConfigRegistry {
+  public:
+    ConfigRegistry();
+    void begin();
+
+    // Hot path: a relaxed atomic load, same cost as reading a global
+    int32_t get(ConfigKey key) const {
+        return values[key].load(std::memory_order_relaxed);
+    }
+
+    bool set(ConfigKey key, int32_t value);
+    void step(ConfigKey key, int8_t direction);
+    void save();
+
+    // Bumped on every change so consumers can re-apply settings lazily
+    uint32_t getVersion() const {
+        return version.load(std::memory_order_acquire);
+    }
+
+    static const ConfigEntry &getEntry(ConfigKey key);
+
+  private:
+    std::atomic<int32_t> values[CONFIG_COUNT];
+    std::atomic<uint32_t> version;
+    std::atomic<uint32_t> savedVersion;
+};
@@ -0,0 +1,128 @@
+#include <math.h>
+#include "dsp_kernels.h"
+
+void dspFirInit(DspFir &fir, const float *coeffs, float *delay, uint16_t taps) {
+    fir.coeffs = coeffs;
+    fir.delay = delay;
+    fir.taps = taps;
+    fir.pos = 0;
+    for (uint16_t i = 0; i < taps; i++) {
+        delay[i] = 0;
+    }
+#if DSP_USE_ESP_DSP
+    dsps_fir_init_f32(&fir.esp, const_cast<float *>(coeffs), delay, taps);
+#endif
+}
+
+void dspFirF32(DspFir &fir, const float *in, float *out, size_t count) {
+#if DSP_USE_ESP_DSP
+    dsps_fir_f32(&fir.esp, in, out, int(count));
+#else
+    dspFirF32Ref(fir, in, out, count);
+#endif
+}
+
+// Same arithmetic order as dsps_fir_f32_ansi, so results match the esp-dsp
+// C fallback exactly and the assembly version to rounding
+void dspFirF32Ref(DspFir &fir, const float *in, float *out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        fir.delay[fir.pos] = in[i];
+        fir.pos = fir.pos + 1 < fir.taps ? fir.pos + 1 : 0;
+
+        float acc = 0;
+        uint16_t tap = 0;
+        for (uint16_t n = fir.pos; n < fir.taps; n++) {
+            acc += fir.coeffs[tap++] * fir.delay[n];
+        }
+        for (uint16_t n = 0; n < fir.pos; n++) {
+            acc += fir.coeffs[tap++] * fir.delay[n];
+        }
+        out[i] = acc;
+    }
+}
+
+void dspBiquadF32(const float *in, float *out, size_t count, const float *coef, float *state) {
+#if DSP_USE_ESP_DSP
+    dsps_biquad_f32(in, out, int(count), const_cast<float *>(coef), state);
+#else
+    dspBiquadF32Ref(in, out, count, coef, state);
+#endif
+}
+
+void dspBiquadF32Ref(const float *in, float *out, size_t count, const float *coef, float *state) {
+    float w1 = state[0];
+    float w2 = state[1];
+    for (size_t i = 0; i < count; i++) {
+        float d0 = in[i] - coef[3] * w1 - coef[4] * w2;
+        out[i] = coef[0] * d0 + coef[1] * w1 + coef[2] * w2;
+        w2 = w1;
+        w1 = d0;
+    }
+    state[0] = w1;
+    state[1] = w2;
+}
+
+// RBJ cookbook low-pass, normalised to a0 = 1
+void dspBiquadLowpass(float *coef, float frequency, float q) {
+    float w0 = 2 * float(M_PI) * frequency;
+    float alpha = sinf(w0) / (2 * q);
+    float c = cosf(w0);
+    float a0 = 1 + alpha;
+
+    coef[0] = (1 - c) / 2 / a0;
+    coef[1] = (1 - c) / a0;
+    coef[2] = coef[0];
+    coef[3] = -2 * c / a0;
+    coef[4] = (1 - alpha) / a0;
+}
+
+// esp-dsp has no integer min/max; this shape (independent lanes, no
+// early exit) is what GCC unrolls and vectorises on either side
+size_t dspMinMaxDecimate(const int16_t *in, size_t count, size_t factor, int16_t *minOut, int16_t *maxOut) {
+    if (factor == 0) {
+        return 0;
+    }
+
+    size_t outputs = 0;
+    for (size_t start = 0; start < count; start += factor) {
+        size_t end = start + factor < count ? start + factor : count;
+        int16_t low = in[start];
+        int16_t high = in[start];
+        for (size_t i = start + 1; i < end; i++) {
+            low = in[i] < low ? in[i] : low;
+            high = in[i] > high ? in[i] : high;
+        }
+        minOut[outputs] = low;
+        maxOut[outputs] = high;
+        outputs++;
+    }
+    return outputs;
+}
+
+DspFixedScale dspFixedScale(float gain, float offset, uint8_t shift) {
+    DspFixedScale scale;
+    double one = double(int64_t(1) << shift);
+    scale.gain = int32_t(lround(double(gain) * one));
+    // Rounding half is folded into the offset so the kernel only shifts
+    scale.offset = llround(double(offset) * one) + (int64_t(1) << shift >> 1);
+    scale.shift = shift;
+    return scale;
+}
+
+void dspInt24ToInt32(const uint8_t *bytes, size_t count, int32_t *out) {
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *word = bytes + i * 3;
+        // Place the word in the top 24 bits, arithmetic shift sign-extends it
+        uint32_t raw = (uint32_t(word[0]) << 24) | (uint32_t(word[1]) << 16) | (uint32_t(word[2]) << 8);
+        out[i] = int32_t(raw) >> 8;
+    }
+}
+
+void dspInt24ToFixed(const uint8_t *bytes, size_t count, const DspFixedScale &scale, int16_t *out) {
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *word = bytes + i * 3;
+        uint32_t raw = (uint32_t(word[0]) << 24) | (uint32_t(word[1]) << 16) | (uint32_t(word[2]) << 8);
+        int64_t value = (int64_t(int32_t(raw) >> 8) * scale.gain + scale.offset) >> scale.shift;
+        out[i] = int16_t(value < INT16_MIN ? INT16_MIN : value > INT16_MAX ? INT16_MAX : value);
+    }
+}
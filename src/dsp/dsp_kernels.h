@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// Block signal kernels. FIR and biquad run on esp-dsp's assembly routines
+// when the SDK ships them and fall back to the portable *Ref versions
+// everywhere else (host builds included). The Ref versions are always
+// compiled so the bench can check one against the other.
+//
+
+#if defined(ESP_PLATFORM) && __has_include("esp_dsp.h")
+#include "esp_dsp.h"
+#define DSP_USE_ESP_DSP 1
+#else
+#define DSP_USE_ESP_DSP 0
+#endif
+
+// FIR with a circular delay line. Taps are applied oldest sample first
+// (esp-dsp's order); a symmetric (linear-phase) filter doesn't care. Keep
+// an instance on one of dspFirF32 or dspFirF32Ref: with DSP_USE_ESP_DSP the
+// two advance separate positions into the delay line.
+struct DspFir {
+    const float *coeffs;
+    float *delay;       // taps floats, owned by the caller
+    uint16_t taps;
+    uint16_t pos;
+#if DSP_USE_ESP_DSP
+    fir_f32_t esp;
+#endif
+};
+
+void dspFirInit(DspFir &fir, const float *coeffs, float *delay, uint16_t taps);
+void dspFirF32(DspFir &fir, const float *in, float *out, size_t count);
+void dspFirF32Ref(DspFir &fir, const float *in, float *out, size_t count);
+
+// Direct form II biquad, coef = { b0, b1, b2, a1, a2 }, state = { w1, w2 }
+void dspBiquadF32(const float *in, float *out, size_t count, const float *coef, float *state);
+void dspBiquadF32Ref(const float *in, float *out, size_t count, const float *coef, float *state);
+
+// Low-pass coefficients, frequency as a fraction of the sample rate (< 0.5)
+void dspBiquadLowpass(float *coef, float frequency, float q);
+
+// Min and max of every `factor` inputs, e.g. a shot squeezed into a graph
+// column. Returns the number of outputs, the last group may be short.
+size_t dspMinMaxDecimate(const int16_t *in, size_t count, size_t factor, int16_t *minOut, int16_t *maxOut);
+
+// out = (raw * gain + offset) >> shift, saturated to int16. Calibration of
+// a linear sensor straight from ADC counts to mbar without going through float.
+struct DspFixedScale {
+    int32_t gain;
+    int64_t offset;
+    uint8_t shift;
+};
+
+DspFixedScale dspFixedScale(float gain, float offset, uint8_t shift = 24);
+
+// Big-endian two's complement 24-bit words (3 bytes each), as most bridge
+// sensor ADCs shift them out
+void dspInt24ToInt32(const uint8_t *bytes, size_t count, int32_t *out);
+void dspInt24ToFixed(const uint8_t *bytes, size_t count, const DspFixedScale &scale, int16_t *out);
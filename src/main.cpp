@@ -9,37 +9,57 @@
 #include "ble/OEPPressure.h"
 #include "ble/OEPLog.h"
 #include "ble/BLEBattery.h"
+#include "ble/BLEClients.h"
+#include "ble/BLEConfig.h"
+#include "ble/BLEChannels.h"
+#include "config/config.h"
 #include "pressure_sensor/pressure_sensor.h"
-
-#include <Wire.h>
-
-// Pressure grid values
-const int16_t PRESSURE_GRID_VALUES[] = {9, 6, 3, 0};
-const int16_t PRESSURE_GRID_COUNT = 4;
-
-// Auto-off timer duration (10 minutes in milliseconds)
-const unsigned long AUTO_OFF_TIMEOUT = 10 * 60 * 1000;
+#include "sensors/i2c_mux.h"
+#include "sensors/sensor_bus.h"
+#include "sensors/i2c_recovery.h"
+#include "sensors/rate_controller.h"
+#include "supervisor/supervisor.h"
+#include "shot/shot_analyser.h"
+#include "shot/shot_recorder.h"
+#include "boot/boot_timeline.h"
+
+// Graph grid covers 0..10 bar
+const int16_t PRESSURE_GRID_MAX = 10;
 
 M5GFX display;
-PressureSensor *pressureSensor;
-
+BootTimeline bootTimeline;
+ConfigRegistry config;
+PressureSensor *pressureSensor;   // channel 0, also reported over the OEP pressure service
+I2CMux *i2cMux;
+SensorBus *sensorBus;
+RateController rateController;
+ShotAnalyser shotAnalyser;
+ShotRecorder shotRecorder;
+Supervisor supervisor;
+int8_t loopTask;
+int8_t sensorTask;
+
+BLEClients *bleClients;
 BLEBattery *bleBattery;
 OEPLog *bleLog;
 OEPPressure *blePressure;
+BLEConfig *bleConfig;
+BLEChannels *bleChannels;
 
 struct DeviceState {
     bool isAsleep;
     bool isBluetoothOn;
-    bool deviceConnected;
     bool lastBTSendSuccessful;
     bool debugMode;
+    bool isMenuOpen;
+    uint8_t menuIndex;
+    uint32_t appliedConfigVersion;
     unsigned long lastRefreshTime;
     unsigned long lastActivityTime;  // Track last activity time
     int16_t lastPressure;           // Track last pressure reading
 
-    unsigned long timerStartTime;   // Timer start time
     unsigned long shotTotalTime;    // Total shot time
-    bool isTimerRunning;    
+    bool isTimerRunning;
 
     BLEServer *pServer;
 };
@@ -47,9 +67,11 @@ struct DeviceState {
 DeviceState deviceState = {
     .isAsleep = false,
     .isBluetoothOn = false,
-    .deviceConnected = false,
     .lastBTSendSuccessful = false,
     .debugMode = false,
+    .isMenuOpen = false,
+    .menuIndex = 0,
+    .appliedConfigVersion = UINT32_MAX,
     .lastRefreshTime = 0,
     .lastActivityTime = 0,
     .lastPressure = -1,
@@ -57,37 +79,106 @@ DeviceState deviceState = {
 };
 
 #define PRESSURE_VALUES_LEN 160
-int16_t pressureValues[PRESSURE_VALUES_LEN];
+int16_t pressureValues[SENSOR_MAX_CHANNELS][PRESSURE_VALUES_LEN];
 
 #define VERSION "0.0.1"
 
 // #define DEBUG
 
-//Setup callbacks onConnect and onDisconnect
-class MyServerCallbacks: public BLEServerCallbacks {
-    void onConnect(BLEServer* pServer) {
-        deviceState.deviceConnected = true;
-    };
-    void onDisconnect(BLEServer* pServer) {
-        deviceState.deviceConnected = false;
-        pServer->startAdvertising();
+#define BUS_RECOVERY_INTERVAL_MS 5000
+
+bool i2cProbe(uint8_t address) {
+  bool ack = M5.Ex_I2C.start(address, false, PRESSURE_SENSOR_I2C_FREQ);
+  M5.Ex_I2C.stop();
+  return ack;
+}
+
+PressureSensor *addPressureChannel(int8_t muxChannel) {
+  PressureSensor *sensor = new PressureSensor(&M5.Ex_I2C);
+  sensor->begin(300);
+  if (sensorBus->addChannel(sensor, muxChannel) < 0) {
+    delete sensor;
+    return nullptr;
+  }
+  Serial.printf("Pressure sensor on channel %d (mux %d)\r\n", sensorBus->getChannelCount() - 1, muxChannel);
+  return sensor;
+}
+
+// All WNK sensors answer at 0x6D, so more than one needs an I2C mux on port A.
+// A sensor wired straight to the port sits upstream of the mux and would ACK
+// on every mux output too, so it rules out the scan: then it is the only
+// channel, otherwise there is one per mux output that answers.
+void discoverSensors() {
+  i2cMux = new I2CMux(&M5.Ex_I2C);
+  if (!i2cMux->isPresent()) {
+    delete i2cMux;
+    i2cMux = nullptr;
+  }
+  sensorBus = new SensorBus(i2cMux);
+
+  if (i2cMux != nullptr) {
+    i2cMux->select(I2C_MUX_NONE);
+  }
+  bool direct = i2cMux == nullptr || i2cProbe(PRESSURE_SENSOR_ADDRESS);
+  if (direct) {
+    pressureSensor = addPressureChannel(I2C_MUX_NONE);
+  }
+
+  for (int8_t muxChannel = 0; i2cMux != nullptr && !direct && muxChannel < I2C_MUX_CHANNELS; muxChannel++) {
+    if (!i2cMux->select(muxChannel) || !i2cProbe(PRESSURE_SENSOR_ADDRESS)) {
+      continue;
     }
-};
+    PressureSensor *sensor = addPressureChannel(muxChannel);
+    if (pressureSensor == nullptr) {
+      pressureSensor = sensor;
+    }
+  }
+
+  // Nothing found: keep the old single-sensor setup so the UI still comes up
+  if (pressureSensor == nullptr) {
+    if (i2cMux != nullptr) {
+      i2cMux->select(I2C_MUX_NONE);
+    }
+    pressureSensor = addPressureChannel(I2C_MUX_NONE);
+  }
+}
+
+// Only ever runs on loop(), which owns port A and the SensorBus state
+bool recoverSensorBus() {
+  bool recovered = recoverI2CBus(&M5.Ex_I2C);
+  sensorBus->reset();
+  return recovered;
+}
 
 void setup() {
+  bootTimeline.stage("setup");
+
+  // Only the display, power and port A are needed to show pressure. IMU, RTC
+  // and speaker are unused, BLE comes up on demand from button B.
   auto cfg = M5.config();
   cfg.serial_baudrate = 115200;   // default=115200. if "Serial" is not needed, set it to 0.
-  cfg.internal_imu = true;        // default=true. use internal IMU.
-  cfg.internal_rtc = true;        // default=true. use internal RTC.
-  cfg.internal_spk = true;        // default=true. use internal speaker.
+  cfg.internal_imu = false;       // default=true. use internal IMU.
+  cfg.internal_rtc = false;       // default=true. use internal RTC.
+  cfg.internal_spk = false;       // default=true. use internal speaker.
   cfg.internal_mic = false;       // default=true. use internal microphone.
   cfg.external_imu = false;       // default=false. use Unit Accel & Gyro.
   cfg.external_rtc = false;       // default=false. use Unit RTC.
   M5.begin(cfg);
-  M5.Speaker.begin();
-  M5.Speaker.setVolume(120);
   display = M5.Lcd;
-  Serial.begin(115200);
+  bootTimeline.stage("m5 + display");
+
+  // Sensor power first, it warms up while the rest of setup runs
+  M5.Power.setExtOutput(true); // Turn on I2C power
+  M5.Ex_I2C.begin(I2C_NUM_0, 33, 32);
+  bootTimeline.stage("port A i2c");
+
+  config.begin();
+  bootTimeline.stage("config");
+
+  loopTask = supervisor.registerTask("loop", config.get(CONFIG_LOOP_BUDGET_MS));
+  sensorTask = supervisor.registerTask("sensor", config.get(CONFIG_LOOP_BUDGET_MS));
+  supervisor.begin();
+  bootTimeline.stage("supervisor");
 
   display.fillScreen(TFT_BLACK);
 
@@ -98,17 +189,12 @@ void setup() {
 
   display.drawString(build, 10, 10);
   display.drawCenterString("Ready to brew!", display.width() / 2, display.height() / 2);
+  bootTimeline.stage("splash");
 
-  // Initialize I2C pressure sensor
-  M5.Power.setExtOutput(true); // Turn on I2C power
-  Wire.begin(33, 32);
-  M5.Ex_I2C.begin(I2C_NUM_0, 33, 32);
-
-  pressureSensor = new PressureSensor(&M5.Ex_I2C);
+  discoverSensors();
+  bootTimeline.stage("sensor ready");
 
-  M5.delay(150);
-  pressureSensor->getPressure(); // Read once to initialize sensor
-  M5.delay(150);
+  shotRecorder.begin(sensorBus->getChannelCount());
 }
 
 void initBle() {
@@ -119,14 +205,20 @@ void initBle() {
     bleLog = new OEPLog();
     Serial.println("Creating battery");
     bleBattery = new BLEBattery(100);
+    Serial.println("Creating clients");
+    bleClients = new BLEClients(rateController.getFramePeriod());
     Serial.println("Creating pressure");
-    blePressure = new OEPPressure();
+    blePressure = new OEPPressure(bleClients);
+    Serial.println("Creating config");
+    bleConfig = new BLEConfig(&config);
+    Serial.println("Creating channels");
+    bleChannels = new BLEChannels(bleClients);
 
     // Pretend that we're PRS-compatible device by name
     BLEDevice::init("PRS-mXcoffee");
 
     deviceState.pServer = BLEDevice::createServer();
-    deviceState.pServer->setCallbacks(new MyServerCallbacks());
+    bleClients->attach(deviceState.pServer);
     
     Serial.println("Attaching battery service");
     bleBattery->setupBatteryService(deviceState.pServer);
@@ -136,6 +228,12 @@ void initBle() {
 
     Serial.println("Attaching pressure service");
     blePressure->registerWithServer(deviceState.pServer);
+
+    Serial.println("Attaching config service");
+    bleConfig->registerWithServer(deviceState.pServer);
+
+    Serial.println("Attaching channels service");
+    bleChannels->registerWithServer(deviceState.pServer);
   } else {
     Serial.println("Reusing existing pServer");
   }
@@ -166,20 +264,31 @@ int16_t getPressure() {
         pressure = int16_t(round(0.5 * (sin_value + 1.0) * 12000));
     }
 #else
-    int16_t pressure = pressureSensor->getPressure();
+    int16_t pressure = sensorBus->getLatest(0).value;
 #endif
 
-  for (int i = 0; i < PRESSURE_VALUES_LEN - 1; i++) {
-    pressureValues[i] = pressureValues[i + 1];
+  for (uint8_t channel = 0; channel < sensorBus->getChannelCount(); channel++) {
+    int16_t value = channel == 0 ? pressure : sensorBus->getLatest(channel).value;
+    for (int i = 0; i < PRESSURE_VALUES_LEN - 1; i++) {
+      pressureValues[channel][i] = pressureValues[channel][i + 1];
+    }
+    pressureValues[channel][PRESSURE_VALUES_LEN - 1] = value;
   }
-  pressureValues[PRESSURE_VALUES_LEN - 1] = pressure;
 
   return pressure;
 }
 
 void sendToBle(int16_t pressure) {
   if (deviceState.isBluetoothOn) {
-    if (deviceState.deviceConnected) {
+    if (bleChannels->hasSubscribers() && sensorBus->getChannelCount() > 1) {
+      SensorSample samples[SENSOR_MAX_CHANNELS];
+      for (uint8_t channel = 0; channel < sensorBus->getChannelCount(); channel++) {
+        samples[channel] = sensorBus->getLatest(channel);
+      }
+      bleChannels->publish(samples, sensorBus->getChannelCount());
+    }
+
+    if (blePressure->hasSubscribers()) {
       blePressure->updatePressure(pressure);
       // display.drawString("Sent to BLE", 10, display.height() - 35);
       deviceState.lastBTSendSuccessful = true;
@@ -190,6 +299,76 @@ void sendToBle(int16_t pressure) {
   }
 }
 
+unsigned long getAutoOffTimeout() {
+  return config.get(CONFIG_AUTO_OFF_MIN) * 60UL * 1000UL;
+}
+
+// Bus cadence, BLE decimation and deadlines all follow the current rate.
+// Idle samples are single conversions, the average only matters in a shot.
+void applyRate() {
+  bool active = rateController.getMode() == RATE_ACTIVE;
+  uint32_t budget = config.get(CONFIG_LOOP_BUDGET_MS);
+  uint16_t activePeriod = rateController.getActivePeriod();
+
+  sensorBus->setOversampling(active ? config.get(CONFIG_SENSOR_OVERSAMPLING) : 1);
+  sensorBus->setSamplePeriod(rateController.getSamplePeriod());
+  supervisor.setBudget(loopTask, budget + rateController.getFramePeriod() - activePeriod);
+  supervisor.setBudget(sensorTask, budget + rateController.getSamplePeriod() - activePeriod);
+  // The cycles in flight were paced by the old rate; leaving idle would
+  // otherwise log a miss against the new, shorter budget
+  supervisor.rearm(loopTask);
+  supervisor.rearm(sensorTask);
+  // sendToBle() publishes once per frame, so that is the cadence clients see
+  if (bleClients != nullptr) {
+    bleClients->setSamplePeriod(rateController.getFramePeriod());
+  }
+}
+
+// Push changed settings into the modules that cache them, without
+// restarting anything. Cheap enough to call every refresh.
+void applyConfig() {
+  uint32_t version = config.getVersion();
+  if (version == deviceState.appliedConfigVersion) {
+    return;
+  }
+  deviceState.appliedConfigVersion = version;
+
+  rateController.setActivePeriod(config.get(CONFIG_REFRESH_PERIOD_MS));
+  rateController.setIdlePeriod(config.get(CONFIG_IDLE_SAMPLE_MS));
+  rateController.takeChange();
+  applyRate();
+  shotAnalyser.setStartPressure(config.get(CONFIG_SHOT_START_PRESSURE));
+  shotAnalyser.setWarnPressure(config.get(CONFIG_WARN_PRESSURE));
+  shotAnalyser.setWarnHorizon(config.get(CONFIG_WARN_HORIZON_MS));
+}
+
+void drawMenu(M5Canvas &canvas) {
+  canvas.fillSprite(TFT_BLACK);
+  canvas.setFont(&fonts::DejaVu18);
+  canvas.setTextColor(TFT_WHITE);
+  canvas.drawString("Settings", 10, 10);
+
+  canvas.setFont(&fonts::DejaVu12);
+  for (uint8_t i = 0; i < CONFIG_COUNT; i++) {
+    const ConfigEntry &entry = ConfigRegistry::getEntry(ConfigKey(i));
+    int16_t y = 36 + i * 17;
+    if (i == deviceState.menuIndex) {
+      canvas.fillRect(0, y - 3, display.width(), 16, TFT_DARKGREY);
+    }
+    canvas.setTextColor(TFT_WHITE);
+    canvas.drawString(entry.label, 10, y);
+    canvas.drawRightString(String(config.get(ConfigKey(i))) + " " + entry.unit, display.width() - 10, y);
+  }
+
+  canvas.setTextColor(TFT_DARKGREY);
+  canvas.drawString("A: next   B: -   C: +   hold A: save", 10, display.height() - 16);
+}
+
+void closeMenu() {
+  deviceState.isMenuOpen = false;
+  config.save();
+}
+
 void drawGraph() {
   // Pressure graph
   const int16_t graphStartX = 10;
@@ -208,16 +387,23 @@ void drawGraph() {
     graph.createSprite(display.width(), display.height());
   }
 
-  int16_t lastPressure = pressureValues[PRESSURE_VALUES_LEN - 1];
+  if (deviceState.isMenuOpen) {
+    drawMenu(graph);
+    display.startWrite();
+    graph.pushSprite(0, 0);
+    display.endWrite();
+    return;
+  }
+
+  int16_t lastPressure = pressureValues[0][PRESSURE_VALUES_LEN - 1];
   String hex_data = pressureSensor->getHexData();
 
   int graphColor;
-  bool showPressureWarning = false;
+  bool showPressureWarning = shotAnalyser.isOverPressureWarning();
 
-  if(lastPressure > 12000) {
+  if(lastPressure > config.get(CONFIG_WARN_PRESSURE) || showPressureWarning) {
     graphColor = TFT_RED;
-    showPressureWarning = true;
-  } else if(lastPressure > 9000) {
+  } else if(lastPressure > config.get(CONFIG_YELLOW_PRESSURE)) {
     graphColor = TFT_YELLOW;
   } else if(lastPressure > 6000) {
     graphColor = TFT_GREEN;
@@ -247,7 +433,8 @@ void drawGraph() {
   } else {
     graph.setTextColor(TFT_DARKGRAY, TFT_BLACK);
   }
-  graph.drawRightString("BT", display.width() - 10, 30);
+  uint8_t bleClientCount = deviceState.isBluetoothOn ? bleClients->connectedCount() : 0;
+  graph.drawRightString(bleClientCount > 1 ? "BT" + String(bleClientCount) : String("BT"), display.width() - 10, 30);
 
   // Draw battery state
   int32_t batteryLevel = M5.Power.getBatteryLevel();
@@ -271,20 +458,33 @@ void drawGraph() {
   // Define darker gray (about half as bright as TFT_DARKGRAY)
   const uint16_t TFT_VERY_DARK_GRAY = graph.color565(20,20,20);
 
-  for (int i = 0; i < PRESSURE_GRID_COUNT; i++) {
-    int16_t pressureY = graphStartY + (10 - PRESSURE_GRID_VALUES[i]) * graphHeight / 10;
+  int16_t gridStep = config.get(CONFIG_GRID_STEP);
+  for (int16_t gridValue = 0; gridValue < PRESSURE_GRID_MAX; gridValue += gridStep) {
+    int16_t pressureY = graphStartY + (PRESSURE_GRID_MAX - gridValue) * graphHeight / PRESSURE_GRID_MAX;
     graph.drawLine(graphStartX, pressureY, graphStartX + graphWidth, pressureY, TFT_VERY_DARK_GRAY);
-    graph.drawString(String(PRESSURE_GRID_VALUES[i]), 0, pressureY - 5);
+    graph.drawString(String(gridValue), 0, pressureY - 5);
   }
 
-  for (int i = 1; i < PRESSURE_VALUES_LEN; i++) {
-    int16_t pressure1 = pressureValues[i - 1];
-    int16_t pressure2 = pressureValues[i];
-    int16_t pressureY1 = graphStartY + graphHeight - pressure1 * graphHeight / maxPressure;
-    int16_t pressureY2 = graphStartY + graphHeight - pressure2 * graphHeight / maxPressure;
-    int16_t pressureX1 = graphStartX + (i - 1) * graphWidth / PRESSURE_VALUES_LEN;
-    int16_t pressureX2 = graphStartX + i * graphWidth / PRESSURE_VALUES_LEN;
-    graph.drawLine(pressureX1, pressureY1, pressureX2, pressureY2, graphColor);
+  // Extra channels are overlaid behind channel 0, each with its own colour
+  const int channelColors[SENSOR_MAX_CHANNELS] = {graphColor, TFT_CYAN, TFT_MAGENTA, TFT_ORANGE};
+  uint8_t channelCount = sensorBus->getChannelCount();
+
+  for (int8_t channel = channelCount - 1; channel >= 0; channel--) {
+    for (int i = 1; i < PRESSURE_VALUES_LEN; i++) {
+      int16_t pressure1 = pressureValues[channel][i - 1];
+      int16_t pressure2 = pressureValues[channel][i];
+      int16_t pressureY1 = graphStartY + graphHeight - pressure1 * graphHeight / maxPressure;
+      int16_t pressureY2 = graphStartY + graphHeight - pressure2 * graphHeight / maxPressure;
+      int16_t pressureX1 = graphStartX + (i - 1) * graphWidth / PRESSURE_VALUES_LEN;
+      int16_t pressureX2 = graphStartX + i * graphWidth / PRESSURE_VALUES_LEN;
+      graph.drawLine(pressureX1, pressureY1, pressureX2, pressureY2, channelColors[channel]);
+    }
+  }
+
+  for (uint8_t channel = 1; channel < channelCount; channel++) {
+    graph.setTextColor(channelColors[channel]);
+    float channelPressure = float(pressureValues[channel][PRESSURE_VALUES_LEN - 1]) / 1000;
+    graph.drawString(String(channel + 1) + ": " + String(channelPressure, 1), graphStartX + 20 + (channel - 1) * 70, graphStartY - 12);
   }
 
   // Switch to larger font for main display
@@ -351,14 +551,34 @@ void drawGraph() {
     graph.setFont(&fonts::DejaVu12);
 
     std::vector<String> debugStrings = {
-      "Last refresh: " + String(deviceState.lastRefreshTime),
+      "Last refresh: " + String(deviceState.lastRefreshTime) + " (boot " + String(bootTimeline.getTimeToFirstSample()) + "ms)",
       "Sensor raw data: " + hex_data,
+      "Deadline misses: " + String(supervisor.getMisses(loopTask)) + " (worst " + String(supervisor.getWorstGap(loopTask)) + "ms), logged " + String(supervisor.getOverrunCount()),
+      "Sensor channels: " + String(sensorBus->getChannelCount()) + (i2cMux != nullptr ? " via mux" : "") + ", errors " + String(sensorBus->getErrors(0)),
+      "Rate: " + String(rateController.getMode() == RATE_ACTIVE ? "active " : "idle ") + String(rateController.getSamplePeriod()) + "ms, frame " + String(rateController.getFramePeriod())
+        + "ms, idle " + String(uint32_t(uint64_t(rateController.getIdleTime(M5.millis())) * 100 / (M5.millis() + 1))) + "%",
       "Pressure (bar): " + String(float(lastPressure) / 1000),
       "Shot timer state: " + String(deviceState.isTimerRunning) + " (" + String(deviceState.shotTotalTime / 1000) + "s)",
+      "Shot phase: " + String(ShotAnalyser::phaseName(shotAnalyser.getPhase())) + " " + String(shotAnalyser.getSlope()) + " mbar/s",
+      "Predicted (1s): " + String(float(shotAnalyser.getPredictedPressure()) / 1000, 1) + " bar",
       "Auto-off / timer set at: " + String(deviceState.lastActivityTime / 1000) + "s",
-      "Auto-off / shutdown in: " + String((deviceState.lastActivityTime + AUTO_OFF_TIMEOUT - deviceState.lastRefreshTime) / 1000) + "s"
+      "Auto-off / shutdown in: " + String((deviceState.lastActivityTime + getAutoOffTimeout() - deviceState.lastRefreshTime) / 1000) + "s"
     };
 
+    for (uint8_t i = 0; bleClients != nullptr && i < BLE_MAX_CLIENTS; i++) {
+      BLEClientState client = bleClients->getClient(i);
+      if (client.connected) {
+        uint32_t sent = 0;
+        uint32_t coalesced = 0;
+        for (const auto &stream : client.streams) {
+          sent += stream.sent;
+          coalesced += stream.coalesced;
+        }
+        debugStrings.push_back("BLE #" + String(client.connId) + ": " + String(client.connInterval * 5 / 4) + "ms 1/" + String(client.decimation)
+          + " sent " + String(sent) + " coalesced " + String(coalesced));
+      }
+    }
+
     for (int i = 0; i < debugStrings.size(); i++) {
       graph.drawString(debugStrings[i], 40, 60 + i * 20);
     }
@@ -371,24 +591,17 @@ void drawGraph() {
 
 // Simple i2c scanner for debugging
 void i2c_scan() {
-  byte error, address;
-  int nDevices;
+  bool found[120];
+  int nDevices = 0;
   Serial.println("Scanning...");
-  nDevices = 0;
-  for(address = 1; address < 127; address++ ) {
-    Wire.beginTransmission(address);
-    error = Wire.endTransmission();
-    if (error == 0) {
+  M5.Ex_I2C.scanID(found);
+  for (int address = 8; address < 120; address++) {
+    if (found[address]) {
       Serial.print("I2C device found at address 0x");
       if (address<16) Serial.print("0");
       Serial.println(address, HEX);
       nDevices++;
     }
-    else if (error==4) {
-      Serial.print("Unknown error at address 0x");
-      if (address<16) Serial.print("0");
-      Serial.println(address, HEX);
-    }
   }
   if (nDevices == 0) Serial.println("No I2C devices found\n");
   else Serial.println("done\n");
@@ -413,55 +626,128 @@ void playBtOffSound() {
   // M5.delay(100);
 }
 
-void updateShotTotalTime() {
-  if (deviceState.isTimerRunning) {
-    unsigned long currentTime = M5.millis();
-    deviceState.shotTotalTime += currentTime - deviceState.timerStartTime;
-    deviceState.timerStartTime = currentTime; // Reset start time for next interval
+void logShotSummary(const ShotSummary &summary) {
+  char line[96];
+  snprintf(line, sizeof(line), "shot %.1fs peak %.1f bar @ %.1fs plateau %.1f bar / %.1fs",
+    summary.duration / 1000.0, summary.peakPressure / 1000.0, summary.timeToPeak / 1000.0,
+    summary.plateauMean / 1000.0, summary.plateauTime / 1000.0);
+
+  if (deviceState.isBluetoothOn && bleLog != nullptr) {
+    bleLog->log(line);
+  } else {
+    Serial.println(line);
   }
 }
 
-void setTimer(int16_t pressure) {
-  unsigned long currentTime = M5.millis();
-
-  if (pressure > 1000) {
-    if (!deviceState.isTimerRunning) {
-      // Start the timer
-      deviceState.isTimerRunning = true;
-      deviceState.timerStartTime = currentTime;
-    } else {
-      // Update the timer
-      updateShotTotalTime();
-    }
-  } else {
-    if (deviceState.isTimerRunning) {
-      // Pause the timer and calculate the total shot time
-      updateShotTotalTime();
-      deviceState.isTimerRunning = false;
+// A shot file row has channel 0's time only. Every other channel drains its
+// own stream up to that time and holds its newest sample, so a row never
+// carries a value taken after it and no channel's samples go unread.
+void recordSample(int16_t pressure, uint32_t time) {
+  static int16_t held[SENSOR_MAX_CHANNELS] = {};
+  int16_t values[SENSOR_MAX_CHANNELS];
+  values[0] = pressure;
+  for (uint8_t channel = 1; channel < sensorBus->getChannelCount(); channel++) {
+    SensorSample sample;
+    while (sensorBus->peek(channel, sample) && int32_t(sample.time - time) <= 0) {
+      sensorBus->read(channel, sample);
+      held[channel] = sample.value;
     }
+    values[channel] = held[channel];
+  }
+  shotRecorder.add(time, values);
+}
+
+void processSample(int16_t pressure, uint32_t time) {
+  shotAnalyser.update(pressure, time);
+  rateController.update(pressure, time, shotAnalyser.isShotRunning());
+
+  if (shotAnalyser.isShotRunning() && !shotRecorder.isRecording()) {
+    shotRecorder.start(shotAnalyser.getShotStartTime());
+  }
+  recordSample(pressure, time);
+
+  deviceState.isTimerRunning = shotAnalyser.isShotRunning();
+  deviceState.shotTotalTime = shotAnalyser.getShotTime();
+
+  ShotSummary summary;
+  if (shotAnalyser.takeSummary(summary)) {
+    logShotSummary(summary);
+
+    int32_t grinder = config.get(CONFIG_GRINDER_SETTING);
+    shotRecorder.finish(summary, config.get(CONFIG_REFRESH_PERIOD_MS),
+      grinder < 0 ? SHOT_FILE_GRINDER_UNKNOWN : grinder, supervisor.getBootCount());
+  }
+}
+
+// Every sample goes through the analyser and recorder as it arrives, only
+// drawing and BLE are paced by the frame rate. Idle frames are half a second
+// apart, but the samples in between still reach the recorder's pre-shot
+// ring, which serves as the pre-trigger buffer.
+void processSamples() {
+  SensorSample sample;
+  while (sensorBus->read(0, sample)) {
+    supervisor.heartbeat(sensorTask);
+    processSample(sample.value, sample.time);
   }
 }
 
 void loop() {
+  supervisor.enter(loopTask, STAGE_INPUT);
   M5.update();
   
   // Update last activity time when there's any button press
   if (M5.BtnA.wasPressed() || M5.BtnB.wasPressed() || M5.BtnC.wasPressed()) {
     deviceState.lastActivityTime = millis();
+    rateController.poke(M5.millis());
   }
   
   // Check for inactivity timeout
-  if (!deviceState.isAsleep && (millis() - deviceState.lastActivityTime >= AUTO_OFF_TIMEOUT)) {
+  if (!deviceState.isAsleep && (millis() - deviceState.lastActivityTime >= getAutoOffTimeout())) {
     M5.Power.powerOff();
     return;
   }
 
   M5.delay(2);
 
-  if (deviceState.lastRefreshTime + 20 < M5.millis()) {
+#ifndef DEBUG
+  supervisor.enter(loopTask, STAGE_SAMPLE);
+  sensorBus->poll();
+  // Recover on repeated errors or when the supervisor saw a hang here, but
+  // keep an unplugged sensor from turning into a reset storm
+  static uint32_t lastBusRecovery = 0;
+  bool recoveryRequested = supervisor.takeBusRecoveryRequest();
+  if ((sensorBus->isStalled() || recoveryRequested) && M5.millis() - lastBusRecovery >= BUS_RECOVERY_INTERVAL_MS) {
+    lastBusRecovery = M5.millis();
+    supervisor.recordBusReset(loopTask, recoverSensorBus());
+  }
+
+  supervisor.enter(loopTask, STAGE_ANALYSE);
+  processSamples();
+#endif
+
+  // A finished shot goes to SD a chunk per pass so drawing and BLE keep up
+  supervisor.enter(loopTask, STAGE_STORAGE);
+  shotRecorder.poll();
+
+  // A rise switches rates on the sample that shows it, not at the next frame
+  if (rateController.takeChange()) {
+    applyRate();
+  }
+
+  if (deviceState.lastRefreshTime + rateController.getFramePeriod() < M5.millis()) {
     deviceState.lastRefreshTime = M5.millis();
+
+    applyConfig();
+#ifdef DEBUG
+    bool isFirstSample = !bootTimeline.isComplete();
+#else
+    // Only a sample the bus has pushed counts, not the zeroed placeholder
+    // that getLatest() returns before the first conversion completes
+    bool isFirstSample = !bootTimeline.isComplete() && sensorBus->getLatest(0).time != 0;
+#endif
     
     // Get current pressure and reset timer if there's any change
+    supervisor.enter(loopTask, STAGE_SAMPLE);
     int16_t currentPressure = getPressure();
     
     if (deviceState.lastPressure == -1 || currentPressure != deviceState.lastPressure) {
@@ -469,20 +755,57 @@ void loop() {
       deviceState.lastPressure = currentPressure;
     }
     
-    setTimer(currentPressure);
+#ifdef DEBUG
+    supervisor.enter(loopTask, STAGE_ANALYSE);
+    processSample(currentPressure, M5.millis());
+#endif
     
+    supervisor.enter(loopTask, STAGE_BLE);
     sendToBle(currentPressure);
 
+    supervisor.enter(loopTask, STAGE_DRAW);
     drawGraph();
+
+    supervisor.heartbeat(loopTask);
+
+    if (isFirstSample) {
+      bootTimeline.firstSample();
+      supervisor.printOverruns();
+    }
+  }
+
+  supervisor.enter(loopTask, STAGE_INPUT);
+
+  if (deviceState.isMenuOpen) {
+    if (M5.BtnA.wasHold()) {
+      closeMenu();
+    } else if (M5.BtnA.wasClicked()) {
+      deviceState.menuIndex++;
+      if (deviceState.menuIndex >= CONFIG_COUNT) {
+        deviceState.menuIndex = 0;
+        closeMenu();
+      }
+    }
+    if (M5.BtnB.wasClicked()) {
+      config.step(ConfigKey(deviceState.menuIndex), -1);
+    }
+    if (M5.BtnC.wasClicked()) {
+      config.step(ConfigKey(deviceState.menuIndex), 1);
+    }
+    return;
   }
 
-  if (M5.BtnA.wasPressed()) {
+  if (M5.BtnA.wasHold()) {
+    deviceState.isMenuOpen = true;
+    deviceState.menuIndex = 0;
+  } else if (M5.BtnA.wasClicked()) {
     deviceState.debugMode = !deviceState.debugMode;
   }
 
   if (M5.BtnB.wasPressed()) {
     deviceState.isBluetoothOn = !deviceState.isBluetoothOn;
     if (deviceState.isBluetoothOn) {
+      supervisor.enter(loopTask, STAGE_BLE_INIT);
       initBle();
       display.drawCenterString("Bluetooth is " + String(deviceState.isBluetoothOn ? "on" : "off"), display.width() / 2, display.height() / 2);
       playBtOnSound();
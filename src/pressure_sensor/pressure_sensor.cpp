@@ -6,111 +6,99 @@
 // Implementation for WNK80MA pressure sensor I2C
 //
 
-PressureSensor::PressureSensor(m5::I2C_Class * i2c_wire) {
+// Linear regression of the manometer reading (bar) against ADC counts
+#define PRESSURE_SENSOR_CAL_GAIN 3.9628e-6f
+#define PRESSURE_SENSOR_CAL_OFFSET -4.9509f
+
+// Per-reading Serial dumps; at 115200 baud they cost tens of ms per sample
+// #define PRESSURE_SENSOR_TRACE
+
+PressureSensor::PressureSensor(m5::I2C_Class * i2c_wire, uint8_t address) {
     wire = i2c_wire;
-    pressure = 0;
+    this->address = address;
+    lastReadOk = false;
+    scale = dspFixedScale(PRESSURE_SENSOR_CAL_GAIN * 1000, PRESSURE_SENSOR_CAL_OFFSET * 1000);
 }
 
-int16_t PressureSensor::getPressure() {
-    float fpressureValues[3];
-
-    for (int i = 0; i < 3; i++) {
-        fpressureValues[i] = getRealPressure();
-        M5.delay(5);
+// Poll until the sensor answers and has a finished conversion instead of
+// sleeping a fixed time after power-up
+bool PressureSensor::begin(uint32_t timeoutMs) {
+    uint32_t startTime = M5.millis();
+
+    while (!isReady()) {
+        if (M5.millis() - startTime >= timeoutMs) {
+            Serial.println("Pressure sensor not ready, continuing anyway");
+            return false;
+        }
+        M5.delay(2);
     }
 
-    Serial.print("fpressureValues: "); Serial.print(fpressureValues[0]); Serial.print(", "); Serial.print(fpressureValues[1]); Serial.print(", "); Serial.println(fpressureValues[2]);
+    uint8_t raw[3];
+    readRaw(raw);
+    return true;
+}
 
-    float fpressure = (fpressureValues[0] + fpressureValues[1] + fpressureValues[2]) / 3;
+// Status register 0x30, bit 3 (Sco) is set while a conversion is running
+bool PressureSensor::isReady() {
+    uint8_t status;
+    if (!wire->readRegister(address, 0x30, &status, 1, PRESSURE_SENSOR_I2C_FREQ)) {
+        return false;
+    }
+    return (status & 0x08) == 0;
+}
 
-    Serial.print("fpressure avg: "); Serial.println(fpressure);
- 
-    // fpressure = 1.238 * fpressure - 1.044;
+// One-shot combined conversion (0x0A to the command register 0x30)
+bool PressureSensor::startConversion() {
+    return wire->writeRegister8(address, 0x30, 0x0A, PRESSURE_SENSOR_I2C_FREQ);
+}
 
-    // pressure = int16_t(fpressure * 10) - 1000; // Convert to mbar and compensate for atmospheric pressure
-    pressure = int16_t(fpressure * 1000); // Convert to mbar
+bool PressureSensor::read(int16_t &value) {
+    uint8_t raw[3];
+    if (!readRaw(raw)) {
+        return false;
+    }
+    dspInt24ToFixed(raw, 1, scale, &value);
+    if (value < 0) {
+        value = 0;
+    }
+    return true;
+}
 
-    Serial.print("pressureconv: "); Serial.println(pressure);
+uint32_t PressureSensor::getConversionTimeUs() {
+    return PRESSURE_SENSOR_CONVERSION_US;
+}
 
-    if (pressure < 0) {
-        pressure = 0;
-    }
+int16_t PressureSensor::getMaxValue() {
+    return getMaxPressure();
+}
 
-    return pressure;
+const char *PressureSensor::getUnit() {
+    return "mbar";
 }
 
 String PressureSensor::getHexData() {
     return hex_data;
 }
 
-float PressureSensor::getRealPressure() {
-    float fadc = 0;
-    float fpressure = 0;
-    uint8_t data[3];
-    uint32_t dat = 0;
-    // Read 3 bytes from register 0x06 of the device with address 0x6D
-    if (wire->readRegister(0x6D, 0x06, data, 3, 100000)) {
-        Serial.println("Data read successfully:");
-        Serial.print(" Byte 1: "); Serial.print(data[0], BIN);
-        Serial.print(" Byte 2: "); Serial.print(data[1], BIN);
-        Serial.print(" Byte 3: "); Serial.print(data[2], BIN);
-
-        Serial.println("");
-
-        Serial.print(" Byte 1: "); Serial.print(data[0], HEX); // Print the first byte
-        Serial.print(" Byte 2: "); Serial.print(data[1], HEX); // Print the second byte
-        Serial.print(" Byte 3: "); Serial.print(data[2], HEX); // Print the third byte
-
+// Raw conversion result: 24-bit two's complement, MSB first, register 0x06
+bool PressureSensor::readRaw(uint8_t *data) {
+    lastReadOk = wire->readRegister(address, 0x06, data, 3, PRESSURE_SENSOR_I2C_FREQ);
+    if (lastReadOk) {
+#ifdef PRESSURE_SENSOR_TRACE
+        Serial.print(" Byte 1: "); Serial.print(data[0], HEX);
+        Serial.print(" Byte 2: "); Serial.print(data[1], HEX);
+        Serial.print(" Byte 3: "); Serial.print(data[2], HEX);
         Serial.println("");
-
+#endif
 
         hex_data = String(data[0], HEX) + " " + String(data[1], HEX) + " " + String(data[2], HEX);
     } else {
         Serial.println("Failed to read data");
         hex_data = String("ER ER ER");
     }
-
-    dat = (data[0] << 16) | (data[1] << 8) | data[2];
-
-    Serial.print("dat: "); Serial.println(dat, BIN);
-    Serial.print("dat: "); Serial.println(dat);
-
-    if (dat & 0x800000) {
-        fadc = dat - 16777216.0;
-    } else {
-        fadc = dat;
-    }
-
-    Serial.print("fadc: "); Serial.println(fadc);
-
-    // float vref = 4.0; // 5V
-    // float adc = vref * fadc / 8388608.0; // 2^23
-    // float lower_range_limit = 0;
-    // float upper_range_limit = 2000; // 20 bar or 2000 kPa
-
-    // float range = upper_range_limit - lower_range_limit;
-
-    // float p_voltage_low = 0.5;
-    // float p_voltage_high = 4.5;
-    // float p_voltage_scale = p_voltage_high - p_voltage_low;
-
-    // float kpa_in_v = p_voltage_scale / range;
-    // fpressure = (adc - p_voltage_low) / kpa_in_v + lower_range_limit;
-
-    // Linear regression coefficients
-    float a = 3.9628e-6;
-    float b = -4.9509;
-
-    // Calculate the manometer value in bar
-    fpressure = a * fadc + b;
-
-    Serial.print("fpressure: "); Serial.println(fpressure);
-
-    return fpressure;
+    return lastReadOk;
 }
 
-
-
 int16_t PressureSensor::getMaxPressure() {
     return 20000;
 }
@@ -4,16 +4,33 @@
 #include <M5Unified.h>
 #include <M5GFX.h>
 #include <string>
+#include "../dsp/dsp_kernels.h"
+#include "../sensors/i2c_sensor.h"
 
-class PressureSensor {
+#define PRESSURE_SENSOR_ADDRESS 0x6D
+#define PRESSURE_SENSOR_I2C_FREQ 100000
+
+#define PRESSURE_SENSOR_CONVERSION_US 3000
+
+class PressureSensor : public I2CSensor {
   public:
-    PressureSensor(m5::I2C_Class * i2c_wire);
-    int16_t getPressure();
+    PressureSensor(m5::I2C_Class * i2c_wire, uint8_t address = PRESSURE_SENSOR_ADDRESS);
+    bool begin(uint32_t timeoutMs);
     int16_t getMaxPressure();
     String getHexData();
+
+    // I2CSensor, values in mbar
+    bool startConversion() override;
+    bool isReady() override;
+    bool read(int16_t &value) override;
+    uint32_t getConversionTimeUs() override;
+    int16_t getMaxValue() override;
+    const char *getUnit() override;
   private:
-    float getRealPressure();
+    bool readRaw(uint8_t *data);
     String hex_data;
     m5::I2C_Class * wire;
-    int16_t pressure;
+    uint8_t address;
+    bool lastReadOk;
+    DspFixedScale scale;    // ADC counts to mbar
 };
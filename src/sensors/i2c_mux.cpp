@@ -0,0 +1,37 @@
+#include <Arduino.h>
+#include <M5Unified.h>
+#include "i2c_mux.h"
+
+#define I2C_MUX_FREQ 100000
+
+I2CMux::I2CMux(m5::I2C_Class * i2c_wire, uint8_t address) {
+    wire = i2c_wire;
+    this->address = address;
+    // The switch keeps its mask across ESP.restart() while port A stays
+    // powered, so the first select() has to write even for I2C_MUX_NONE
+    invalidate();
+}
+
+bool I2CMux::isPresent() {
+    bool ack = wire->start(address, false, I2C_MUX_FREQ);
+    wire->stop();
+    return ack;
+}
+
+void I2CMux::invalidate() {
+    selected = I2C_MUX_NONE - 1;
+}
+
+// Only touches the bus when the channel actually changes
+bool I2CMux::select(int8_t channel) {
+    if (channel == selected) {
+        return true;
+    }
+
+    uint8_t mask = channel == I2C_MUX_NONE ? 0 : (1 << channel);
+    bool ok = wire->start(address, false, I2C_MUX_FREQ) && wire->write(mask);
+    wire->stop();
+
+    selected = ok ? channel : I2C_MUX_NONE - 1;  // unknown, force a rewrite next time
+    return ok;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+#include <M5Unified.h>
+
+#define I2C_MUX_ADDRESS 0x70
+#define I2C_MUX_CHANNELS 8
+#define I2C_MUX_NONE -1
+
+//
+// TCA9548A / PaHub style 1-of-8 I2C switch
+//
+class I2CMux {
+  public:
+    I2CMux(m5::I2C_Class * i2c_wire, uint8_t address = I2C_MUX_ADDRESS);
+    bool isPresent();
+    bool select(int8_t channel);
+    void invalidate();  // after a bus reset the switch state is unknown
+
+  private:
+    m5::I2C_Class * wire;
+    uint8_t address;
+    int8_t selected;
+};
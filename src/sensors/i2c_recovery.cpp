@@ -0,0 +1,42 @@
+#include <Arduino.h>
+#include <M5Unified.h>
+#include "i2c_recovery.h"
+
+#define I2C_RECOVERY_PULSES 9
+#define I2C_RECOVERY_HALF_PERIOD_US 5  // 100 kHz
+
+bool recoverI2CBus(m5::I2C_Class * wire) {
+    i2c_port_t port = wire->getPort();
+    int sda = wire->getSDA();
+    int scl = wire->getSCL();
+
+    wire->release();
+
+    pinMode(sda, INPUT_PULLUP);
+    pinMode(scl, OUTPUT_OPEN_DRAIN);
+    digitalWrite(scl, HIGH);
+    delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+
+    // Up to nine clocks finish whatever byte the slave thinks it is sending
+    for (int i = 0; i < I2C_RECOVERY_PULSES && digitalRead(sda) == LOW; i++) {
+        digitalWrite(scl, LOW);
+        delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+        digitalWrite(scl, HIGH);
+        delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+    }
+
+    // STOP: SDA low to high while SCL is high
+    pinMode(sda, OUTPUT_OPEN_DRAIN);
+    digitalWrite(sda, LOW);
+    delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+    digitalWrite(scl, HIGH);
+    delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+    digitalWrite(sda, HIGH);
+    delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+
+    pinMode(sda, INPUT_PULLUP);
+    bool released = digitalRead(sda) == HIGH;
+
+    wire->begin(port, sda, scl);
+    return released;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <Arduino.h>
+#include <M5Unified.h>
+
+// Frees a bus a slave is holding by clocking out its pending byte, issues a
+// STOP and brings the controller back up on the same pins. True when SDA
+// is released afterwards.
+bool recoverI2CBus(m5::I2C_Class * wire);
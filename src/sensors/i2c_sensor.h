@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Arduino.h>
+
+//
+// Split-phase I2C sensor driven by SensorBus: trigger a conversion, wait for
+// it without holding the bus, then read. Any device on port A that can work
+// this way (pressure transducers, a flow meter) can share the bus scheduler.
+//
+class I2CSensor {
+  public:
+    virtual ~I2CSensor() {}
+
+    virtual bool startConversion() = 0;
+    virtual bool isReady() = 0;
+    virtual bool read(int16_t &value) = 0;  // in getUnit()
+
+    virtual uint32_t getConversionTimeUs() = 0;  // earliest time worth polling isReady()
+    virtual int16_t getMaxValue() = 0;
+    virtual const char *getUnit() = 0;
+};
@@ -0,0 +1,98 @@
+#include "rate_controller.h"
+
+// Starts active, the first seconds after boot are usually spent at the machine
+RateController::RateController(uint16_t activePeriodMs, uint16_t idlePeriodMs) {
+    this->activePeriodMs = activePeriodMs;
+    this->idlePeriodMs = idlePeriodMs;
+    mode = RATE_ACTIVE;
+    changed = true;
+
+    primed = false;
+    lastPressure = 0;
+    lastActive = 0;
+    idleSince = 0;
+    idleTotal = 0;
+}
+
+void RateController::setActivePeriod(uint16_t periodMs) {
+    if (periodMs != activePeriodMs) {
+        activePeriodMs = periodMs;
+        changed = true;
+    }
+}
+
+void RateController::setIdlePeriod(uint16_t periodMs) {
+    if (periodMs != idlePeriodMs) {
+        idlePeriodMs = periodMs;
+        changed = true;
+    }
+}
+
+// Only the sample itself is looked at, no filtering: a filtered trigger
+// would cost the very samples at the start of the shot this is meant to catch
+void RateController::update(int16_t pressure, uint32_t now, bool shotRunning) {
+    bool rising = primed && pressure - lastPressure >= RATE_TRIGGER_RISE;
+    primed = true;
+    lastPressure = pressure;
+
+    if (shotRunning || rising || pressure >= RATE_TRIGGER_PRESSURE) {
+        lastActive = now;
+        setMode(RATE_ACTIVE, now);
+    } else if (mode == RATE_ACTIVE && now - lastActive >= RATE_IDLE_HOLD_MS) {
+        setMode(RATE_IDLE, now);
+    }
+}
+
+void RateController::poke(uint32_t now) {
+    lastActive = now;
+    setMode(RATE_ACTIVE, now);
+}
+
+bool RateController::takeChange() {
+    bool result = changed;
+    changed = false;
+    return result;
+}
+
+RateMode RateController::getMode() {
+    return mode;
+}
+
+// Idle never samples faster than active, whatever the two settings say
+uint16_t RateController::getSamplePeriod() {
+    if (mode == RATE_ACTIVE || idlePeriodMs < activePeriodMs) {
+        return activePeriodMs;
+    }
+    return idlePeriodMs;
+}
+
+// Active frames follow the samples one to one; idle ones never come faster
+// than the samples they would show
+uint16_t RateController::getFramePeriod() {
+    if (mode == RATE_ACTIVE) {
+        return activePeriodMs;
+    }
+    uint16_t samplePeriod = getSamplePeriod();
+    return samplePeriod > RATE_IDLE_FRAME_MS ? samplePeriod : RATE_IDLE_FRAME_MS;
+}
+
+uint16_t RateController::getActivePeriod() {
+    return activePeriodMs;
+}
+
+uint32_t RateController::getIdleTime(uint32_t now) {
+    return mode == RATE_IDLE ? idleTotal + (now - idleSince) : idleTotal;
+}
+
+void RateController::setMode(RateMode mode, uint32_t now) {
+    if (mode == this->mode) {
+        return;
+    }
+    if (mode == RATE_IDLE) {
+        idleSince = now;
+    } else {
+        idleTotal += now - idleSince;
+    }
+    this->mode = mode;
+    changed = true;
+}
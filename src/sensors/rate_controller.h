@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+#define RATE_TRIGGER_PRESSURE 200   // mbar, clear of the noise around zero
+#define RATE_TRIGGER_RISE 100       // mbar between two consecutive samples
+#define RATE_IDLE_HOLD_MS 5000      // quiet this long before slowing down
+#define RATE_IDLE_FRAME_MS 500
+
+enum RateMode : uint8_t {
+    RATE_IDLE,
+    RATE_ACTIVE
+};
+
+//
+// Activity-driven sample and frame rate. While the machine sits at zero the
+// sensor is read slowly and the screen redrawn a couple of times a second;
+// a rise, a running shot or a button press switches to full rate on the
+// sample that shows it.
+//
+class RateController {
+  public:
+    RateController(uint16_t activePeriodMs = 20, uint16_t idlePeriodMs = 100);
+
+    void setActivePeriod(uint16_t periodMs);
+    void setIdlePeriod(uint16_t periodMs);
+
+    void update(int16_t pressure, uint32_t now, bool shotRunning);  // every sample
+    void poke(uint32_t now);                                        // user input
+
+    bool takeChange();  // true once after the mode or a period changed
+
+    RateMode getMode();
+    uint16_t getSamplePeriod();
+    uint16_t getFramePeriod();
+    uint16_t getActivePeriod();
+    uint32_t getIdleTime(uint32_t now);   // ms spent idle since boot
+
+  private:
+    void setMode(RateMode mode, uint32_t now);
+
+    uint16_t activePeriodMs;
+    uint16_t idlePeriodMs;
+    RateMode mode;
+    bool changed;
+
+    bool primed;
+    int16_t lastPressure;
+    uint32_t lastActive;
+    uint32_t idleSince;
+    uint32_t idleTotal;
+};
@@ -0,0 +1,197 @@
+#include <Arduino.h>
+#include <M5Unified.h>
+#include "sensor_bus.h"
+
+SensorBus::SensorBus(I2CMux * mux) {
+    this->mux = mux;
+    channelCount = 0;
+    samplePeriodUs = 20000;
+    oversampling = 1;
+}
+
+int8_t SensorBus::addChannel(I2CSensor * sensor, int8_t muxChannel) {
+    if (channelCount >= SENSOR_MAX_CHANNELS) {
+        return -1;
+    }
+
+    SensorChannel &channel = channels[channelCount];
+    channel = {};
+    channel.sensor = sensor;
+    channel.muxChannel = muxChannel;
+    channel.state = SENSOR_WAITING;
+    channel.nextDue = micros();
+
+    return channelCount++;
+}
+
+uint8_t SensorBus::getChannelCount() {
+    return channelCount;
+}
+
+I2CSensor *SensorBus::getSensor(uint8_t channel) {
+    return channel < channelCount ? channels[channel].sensor : nullptr;
+}
+
+void SensorBus::setSamplePeriod(uint32_t periodMs) {
+    uint32_t periodUs = periodMs * 1000;
+    uint32_t now = micros();
+
+    // Speeding up takes effect now, not once the old slow slot comes round
+    for (uint8_t i = 0; i < channelCount; i++) {
+        SensorChannel &channel = channels[i];
+        if (channel.state == SENSOR_WAITING && int32_t(channel.nextDue - (now + periodUs)) > 0) {
+            channel.nextDue = now;
+        }
+    }
+    samplePeriodUs = periodUs;
+}
+
+void SensorBus::setOversampling(uint8_t conversions) {
+    oversampling = constrain(conversions, 1, 8);
+}
+
+void SensorBus::poll() {
+    for (uint8_t i = 0; i < channelCount; i++) {
+        SensorChannel &channel = channels[i];
+        uint32_t now = micros();
+
+        if (channel.state == SENSOR_WAITING) {
+            if (int32_t(now - channel.nextDue) < 0) {
+                continue;
+            }
+            if (select(channel) && channel.sensor->startConversion()) {
+                channel.state = SENSOR_CONVERTING;
+                channel.conversionStart = now;
+            } else {
+                fail(channel);
+                channel.nextDue = now + samplePeriodUs;
+            }
+            continue;
+        }
+
+        // Converting: leave the bus to the other channels until it can be done
+        uint32_t elapsed = now - channel.conversionStart;
+        if (elapsed < channel.sensor->getConversionTimeUs()) {
+            continue;
+        }
+
+        if (!select(channel) || !channel.sensor->isReady()) {
+            if (elapsed > SENSOR_CONVERSION_TIMEOUT_US) {
+                fail(channel);
+                channel.accumulated = 0;
+                channel.accumulator = 0;
+                channel.state = SENSOR_WAITING;
+                channel.nextDue = now + samplePeriodUs;
+            }
+            continue;
+        }
+
+        int16_t value;
+        if (channel.sensor->read(value)) {
+            channel.accumulator += value;
+            channel.accumulated++;
+            channel.consecutiveErrors = 0;
+        } else {
+            fail(channel);
+        }
+
+        if (channel.accumulated >= oversampling) {
+            push(channel, int16_t(channel.accumulator / channel.accumulated));
+            channel.accumulated = 0;
+            channel.accumulator = 0;
+        } else if (channel.sensor->startConversion()) {
+            // Oversampling: chain the next conversion straight away
+            channel.conversionStart = micros();
+            continue;
+        }
+
+        // Keep a steady cadence, but never try to catch up on missed slots
+        channel.state = SENSOR_WAITING;
+        channel.nextDue += samplePeriodUs;
+        if (int32_t(now - channel.nextDue) > 0) {
+            channel.nextDue = now;
+        }
+    }
+}
+
+bool SensorBus::read(uint8_t channel, SensorSample &sample) {
+    if (channel >= channelCount || channels[channel].streamCount == 0) {
+        return false;
+    }
+    SensorChannel &c = channels[channel];
+    sample = c.stream[c.streamHead];
+    c.streamHead = (c.streamHead + 1) % SENSOR_STREAM_LEN;
+    c.streamCount--;
+    return true;
+}
+
+bool SensorBus::peek(uint8_t channel, SensorSample &sample) {
+    if (channel >= channelCount || channels[channel].streamCount == 0) {
+        return false;
+    }
+    sample = channels[channel].stream[channels[channel].streamHead];
+    return true;
+}
+
+SensorSample SensorBus::getLatest(uint8_t channel) {
+    if (channel >= channelCount) {
+        return {};
+    }
+    return channels[channel].latest;
+}
+
+uint32_t SensorBus::getErrors(uint8_t channel) {
+    return channel < channelCount ? channels[channel].errors : 0;
+}
+
+bool SensorBus::isStalled() {
+    for (uint8_t i = 0; i < channelCount; i++) {
+        if (channels[i].consecutiveErrors >= SENSOR_STALL_ERRORS) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SensorBus::reset() {
+    uint32_t now = micros();
+    for (uint8_t i = 0; i < channelCount; i++) {
+        SensorChannel &channel = channels[i];
+        channel.state = SENSOR_WAITING;
+        channel.nextDue = now;
+        channel.accumulator = 0;
+        channel.accumulated = 0;
+        channel.consecutiveErrors = 0;
+    }
+    if (mux != nullptr) {
+        mux->invalidate();
+    }
+}
+
+void SensorBus::fail(SensorChannel &channel) {
+    channel.errors++;
+    if (channel.consecutiveErrors < UINT8_MAX) {
+        channel.consecutiveErrors++;
+    }
+}
+
+bool SensorBus::select(SensorChannel &channel) {
+    if (mux == nullptr) {
+        return true;
+    }
+    return mux->select(channel.muxChannel);
+}
+
+// A full stream drops its oldest sample
+void SensorBus::push(SensorChannel &channel, int16_t value) {
+    SensorSample sample = { M5.millis(), value };
+    channel.latest = sample;
+    channel.samples++;
+
+    if (channel.streamCount == SENSOR_STREAM_LEN) {
+        channel.streamHead = (channel.streamHead + 1) % SENSOR_STREAM_LEN;
+        channel.streamCount--;
+    }
+    channel.stream[(channel.streamHead + channel.streamCount) % SENSOR_STREAM_LEN] = sample;
+    channel.streamCount++;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Arduino.h>
+#include <M5Unified.h>
+#include "i2c_sensor.h"
+#include "i2c_mux.h"
+
+#define SENSOR_MAX_CHANNELS 4
+#define SENSOR_STREAM_LEN 32
+#define SENSOR_CONVERSION_TIMEOUT_US 20000
+#define SENSOR_STALL_ERRORS 10      // consecutive failures before the bus counts as stuck
+
+struct SensorSample {
+    uint32_t time;   // ms
+    int16_t value;
+};
+
+enum SensorChannelState : uint8_t {
+    SENSOR_WAITING,     // until the next sample is due
+    SENSOR_CONVERTING
+};
+
+struct SensorChannel {
+    I2CSensor *sensor;
+    int8_t muxChannel;
+    SensorChannelState state;
+    uint32_t nextDue;           // us
+    uint32_t conversionStart;   // us
+    int32_t accumulator;
+    uint8_t accumulated;
+
+    SensorSample latest;
+    SensorSample stream[SENSOR_STREAM_LEN];
+    uint8_t streamHead;
+    uint8_t streamCount;
+
+    uint32_t samples;
+    uint32_t errors;
+    uint8_t consecutiveErrors;
+};
+
+//
+// Schedules conversions of every registered sensor on one shared bus. All
+// channels are triggered together and read back as each finishes, so the
+// conversion waits overlap and N sensors take about as long as one.
+// poll() never blocks; call it as often as the main loop spins.
+//
+class SensorBus {
+  public:
+    SensorBus(I2CMux * mux = nullptr);
+
+    int8_t addChannel(I2CSensor * sensor, int8_t muxChannel = I2C_MUX_NONE);
+    uint8_t getChannelCount();
+    I2CSensor *getSensor(uint8_t channel);
+
+    void setSamplePeriod(uint32_t periodMs);
+    void setOversampling(uint8_t conversions);
+
+    void poll();
+
+    bool read(uint8_t channel, SensorSample &sample);  // oldest unread sample
+    bool peek(uint8_t channel, SensorSample &sample);  // same, left unread
+    SensorSample getLatest(uint8_t channel);
+    uint32_t getErrors(uint8_t channel);
+    bool isStalled();
+    void reset();  // after a bus recovery: abandon conversions in flight
+
+  private:
+    void fail(SensorChannel &channel);
+    bool select(SensorChannel &channel);
+    void push(SensorChannel &channel, int16_t value);
+
+    I2CMux *mux;
+    SensorChannel channels[SENSOR_MAX_CHANNELS];
+    uint8_t channelCount;
+    uint32_t samplePeriodUs;
+    uint8_t oversampling;
+};
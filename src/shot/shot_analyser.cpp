@@ -0,0 +1,314 @@
+#include "shot_analyser.h"
+
+//
+// Pressure is smoothed with a one-pole filter, slope and curvature are
+// filtered finite differences of it. Phase changes need both a threshold
+// pair (enter/exit) and a minimum dwell time, so noise cannot make them chatter.
+//
+
+// Shot start / end
+#define REST_PRESSURE 150           // mbar, at or below this the machine is at rest
+#define START_SLOPE 1500            // mbar/s sustained rise that starts a shot
+#define START_SAMPLES 2
+#define DEFAULT_START_PRESSURE 1000 // mbar, slow pre-infusion that never shows a clear rise
+#define END_PRESSURE 500            // mbar, the shot_start setting must stay above it
+#define END_HOLD_MS 400
+#define SETTLED_SLOPE 300           // mbar/s, below startPressure and no faster rise than this
+#define SETTLED_HOLD_MS 1000        // ends a shot on residual pressure that never reaches END_PRESSURE
+
+// Phase hysteresis, mbar/s
+#define RAMP_ENTER_SLOPE 2000
+#define RAMP_EXIT_SLOPE 700
+#define DECLINE_ENTER_SLOPE -1500
+#define DECLINE_EXIT_SLOPE -400
+#define PLATEAU_MIN_PRESSURE 3000   // mbar, flat below this is pre-infusion
+#define MIN_PHASE_MS 100
+
+// Over-pressure prediction, mbar. A normal ramp into a 9 bar plateau
+// extrapolates well past the limit, so predictions only count near it
+#define WARN_PREDICT_BAND 2000
+#define WARN_RELEASE 1000
+#define WARN_HOLD_MS 500
+
+ShotAnalyser::ShotAnalyser(int16_t warnPressure, uint16_t warnHorizonMs) {
+    this->warnPressure = warnPressure;
+    this->warnHorizonMs = warnHorizonMs;
+    startPressure = DEFAULT_START_PRESSURE;
+
+    primed = false;
+    lastTime = 0;
+    pressureQ4 = 0;
+    slopeQ4 = 0;
+    curvatureQ4 = 0;
+
+    phase = SHOT_IDLE;
+    riseCount = 0;
+    baselineTime = 0;
+    lastActiveTime = 0;
+    settledSince = 0;
+    phaseSince = 0;
+
+    predictedPressure = 0;
+    warning = false;
+    warningSince = 0;
+
+    current = {};
+    plateauSum = 0;
+    plateauCount = 0;
+    last = {};
+    summaryPending = false;
+}
+
+void ShotAnalyser::update(int16_t pressure, uint32_t now) {
+    if (!primed) {
+        primed = true;
+        lastTime = now;
+        baselineTime = now;
+        pressureQ4 = int32_t(pressure) << 4;
+        return;
+    }
+
+    uint32_t dt = now - lastTime;
+    if (dt == 0) {
+        return;
+    }
+    lastTime = now;
+
+    int32_t previousPressureQ4 = pressureQ4;
+    pressureQ4 += ((int32_t(pressure) << 4) - pressureQ4) >> 2;
+
+    int32_t slope = int32_t(int64_t(pressureQ4 - previousPressureQ4) * 1000 / dt);
+    int32_t previousSlopeQ4 = slopeQ4;
+    slopeQ4 += (slope - slopeQ4) >> 2;
+
+    int64_t curvature = int64_t(slopeQ4 - previousSlopeQ4) * 1000 / dt;
+    if (curvature > INT32_MAX / 2) {
+        curvature = INT32_MAX / 2;
+    } else if (curvature < INT32_MIN / 2) {
+        curvature = INT32_MIN / 2;
+    }
+    curvatureQ4 += (int32_t(curvature) - curvatureQ4) >> 3;
+
+    updatePhase(pressure, now);
+
+    if (phase != SHOT_IDLE) {
+        if (pressure > current.peakPressure) {
+            current.peakPressure = pressure;
+            current.timeToPeak = now - current.startTime;
+        }
+        if (phase == SHOT_PLATEAU) {
+            plateauSum += pressure;
+            plateauCount++;
+            current.plateauTime += dt;
+        }
+    }
+
+    updateWarning(pressure, now);
+}
+
+void ShotAnalyser::setWarnPressure(int16_t pressure) {
+    warnPressure = pressure;
+}
+
+void ShotAnalyser::setWarnHorizon(uint16_t horizonMs) {
+    warnHorizonMs = horizonMs;
+}
+
+void ShotAnalyser::setStartPressure(int16_t pressure) {
+    startPressure = pressure;
+}
+
+void ShotAnalyser::updatePhase(int16_t pressure, uint32_t now) {
+    int32_t slope = slopeQ4 >> 4;
+
+    if (phase == SHOT_IDLE) {
+        if (pressure <= REST_PRESSURE) {
+            baselineTime = now;
+            riseCount = 0;
+            return;
+        }
+
+        // Residual pressure between shots can sit above REST_PRESSURE for
+        // minutes, so the baseline is the last sample before the rise, not
+        // the last one at rest
+        riseCount = slope >= START_SLOPE ? riseCount + 1 : 0;
+        if (riseCount == 0) {
+            baselineTime = now;
+        }
+        if (riseCount >= START_SAMPLES || pressure >= startPressure) {
+            // The rise began at the last sample at rest, not when it was confirmed
+            startShot(baselineTime);
+            lastActiveTime = now;
+            settledSince = now;
+            phase = slope >= RAMP_ENTER_SLOPE ? SHOT_RAMP : SHOT_PREINFUSION;
+            phaseSince = now;
+        }
+        return;
+    }
+
+    if (pressure >= END_PRESSURE) {
+        lastActiveTime = now;
+    } else if (now - lastActiveTime >= END_HOLD_MS) {
+        finishShot();
+        return;
+    }
+
+    // Machines that hold 0.5-1 bar after the shot never get below
+    // END_PRESSURE. Once the shot has been over startPressure, settling back
+    // under it with a flat or falling slope ends it too, at the last sample
+    // before it settled
+    if (current.peakPressure >= startPressure && pressure < startPressure && slope < SETTLED_SLOPE) {
+        if (now - settledSince >= SETTLED_HOLD_MS) {
+            lastActiveTime = settledSince;
+            finishShot();
+            return;
+        }
+    } else {
+        settledSince = now;
+    }
+
+    if (now - phaseSince < MIN_PHASE_MS) {
+        return;
+    }
+
+    ShotPhase next = phase;
+    switch (phase) {
+        case SHOT_PREINFUSION:
+            if (slope >= RAMP_ENTER_SLOPE) {
+                next = SHOT_RAMP;
+            }
+            break;
+        case SHOT_RAMP:
+            if (slope < RAMP_EXIT_SLOPE) {
+                next = pressure >= PLATEAU_MIN_PRESSURE ? SHOT_PLATEAU : SHOT_PREINFUSION;
+            }
+            break;
+        case SHOT_PLATEAU:
+            if (slope >= RAMP_ENTER_SLOPE) {
+                next = SHOT_RAMP;
+            } else if (slope <= DECLINE_ENTER_SLOPE) {
+                next = SHOT_DECLINE;
+            }
+            break;
+        case SHOT_DECLINE:
+            if (slope >= RAMP_ENTER_SLOPE) {
+                next = SHOT_RAMP;
+            } else if (slope > DECLINE_EXIT_SLOPE && pressure >= PLATEAU_MIN_PRESSURE) {
+                next = SHOT_PLATEAU;
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (next != phase) {
+        phase = next;
+        phaseSince = now;
+    }
+}
+
+// p(t + h) = p + v*h + a*h^2/2, evaluated in Q4 with h in ms. A pressure
+// step looks like a huge positive curvature, so that term may at most double
+// the linear one; a rise that is levelling off still pulls the estimate down.
+void ShotAnalyser::updateWarning(int16_t pressure, uint32_t now) {
+    int64_t h = warnHorizonMs;
+    int64_t linearQ4 = int64_t(slopeQ4) * h / 1000;
+    int64_t curvedQ4 = int64_t(curvatureQ4) * h * h / 2000000;
+    if (curvedQ4 > 0 && curvedQ4 > (linearQ4 > 0 ? linearQ4 : 0)) {
+        curvedQ4 = linearQ4 > 0 ? linearQ4 : 0;
+    }
+    int64_t predicted = (int64_t(pressureQ4) + linearQ4 + curvedQ4) >> 4;
+
+    if (predicted < 0) {
+        predicted = 0;
+    } else if (predicted > INT16_MAX) {
+        predicted = INT16_MAX;
+    }
+    predictedPressure = int16_t(predicted);
+
+    if (!warning) {
+        warning = pressure >= warnPressure
+            || (slopeQ4 > 0 && pressure >= warnPressure - WARN_PREDICT_BAND && predictedPressure >= warnPressure);
+        warningSince = now;
+    } else if (now - warningSince >= WARN_HOLD_MS) {
+        warning = pressure >= warnPressure - WARN_RELEASE || predictedPressure >= warnPressure - WARN_RELEASE;
+    }
+}
+
+void ShotAnalyser::startShot(uint32_t startTime) {
+    current = {};
+    current.startTime = startTime;
+    plateauSum = 0;
+    plateauCount = 0;
+}
+
+void ShotAnalyser::finishShot() {
+    current.duration = lastActiveTime - current.startTime;
+    current.plateauMean = plateauCount > 0 ? int16_t(plateauSum / int32_t(plateauCount)) : 0;
+    last = current;
+    summaryPending = true;
+
+    phase = SHOT_IDLE;
+    phaseSince = lastTime;
+    baselineTime = lastTime;
+    riseCount = 0;
+}
+
+ShotPhase ShotAnalyser::getPhase() {
+    return phase;
+}
+
+bool ShotAnalyser::isShotRunning() {
+    return phase != SHOT_IDLE;
+}
+
+uint32_t ShotAnalyser::getShotTime() {
+    if (phase != SHOT_IDLE) {
+        return lastTime - current.startTime;
+    }
+    return last.duration;
+}
+
+uint32_t ShotAnalyser::getShotStartTime() {
+    return phase != SHOT_IDLE ? current.startTime : last.startTime;
+}
+
+int32_t ShotAnalyser::getSlope() {
+    return slopeQ4 >> 4;
+}
+
+int32_t ShotAnalyser::getCurvature() {
+    return curvatureQ4 >> 4;
+}
+
+int16_t ShotAnalyser::getPredictedPressure() {
+    return predictedPressure;
+}
+
+bool ShotAnalyser::isOverPressureWarning() {
+    return warning;
+}
+
+bool ShotAnalyser::takeSummary(ShotSummary &summary) {
+    if (!summaryPending) {
+        return false;
+    }
+    summary = last;
+    summaryPending = false;
+    return true;
+}
+
+ShotSummary ShotAnalyser::getLastSummary() {
+    return last;
+}
+
+const char *ShotAnalyser::phaseName(ShotPhase phase) {
+    switch (phase) {
+        case SHOT_IDLE: return "idle";
+        case SHOT_PREINFUSION: return "pre-infusion";
+        case SHOT_RAMP: return "ramp";
+        case SHOT_PLATEAU: return "plateau";
+        case SHOT_DECLINE: return "decline";
+    }
+    return "?";
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+//
+// Streaming shot analyser: O(1) work per sample, integer maths only
+//
+
+enum ShotPhase : uint8_t {
+    SHOT_IDLE,
+    SHOT_PREINFUSION,
+    SHOT_RAMP,
+    SHOT_PLATEAU,
+    SHOT_DECLINE
+};
+
+struct ShotSummary {
+    uint32_t startTime;      // ms, device clock
+    uint32_t duration;       // ms
+    int16_t peakPressure;    // mbar
+    uint32_t timeToPeak;     // ms from shot start
+    int16_t plateauMean;     // mbar, 0 if the shot never reached a plateau
+    uint32_t plateauTime;    // ms spent in plateau
+};
+
+class ShotAnalyser {
+  public:
+    ShotAnalyser(int16_t warnPressure = 12000, uint16_t warnHorizonMs = 1000);
+
+    void update(int16_t pressure, uint32_t now);
+
+    void setWarnPressure(int16_t pressure);
+    void setWarnHorizon(uint16_t horizonMs);
+    void setStartPressure(int16_t pressure);
+
+    ShotPhase getPhase();
+    bool isShotRunning();
+    uint32_t getShotTime();
+    uint32_t getShotStartTime();
+    int32_t getSlope();             // mbar/s
+    int32_t getCurvature();         // mbar/s^2
+    int16_t getPredictedPressure(); // mbar, warnHorizonMs ahead
+    bool isOverPressureWarning();
+
+    bool takeSummary(ShotSummary &summary); // true once per finished shot
+    ShotSummary getLastSummary();
+
+    static const char *phaseName(ShotPhase phase);
+
+  private:
+    void startShot(uint32_t now);
+    void finishShot();
+    void updatePhase(int16_t pressure, uint32_t now);
+    void updateWarning(int16_t pressure, uint32_t now);
+
+    int16_t warnPressure;
+    uint16_t warnHorizonMs;
+    int16_t startPressure;
+
+    // Filter state, Q4 fixed point (value * 16)
+    bool primed;
+    uint32_t lastTime;
+    int32_t pressureQ4;
+    int32_t slopeQ4;        // mbar/s
+    int32_t curvatureQ4;    // mbar/s^2
+
+    ShotPhase phase;
+    uint8_t riseCount;
+    uint32_t baselineTime;  // last sample before the rise, a rising shot is back-dated to it
+    uint32_t lastActiveTime; // last sample above the end-of-shot pressure
+    uint32_t settledSince;  // last sample that was not settled below startPressure
+    uint32_t phaseSince;
+
+    int16_t predictedPressure;
+    bool warning;
+    uint32_t warningSince;
+
+    // Running summary of the shot in progress
+    ShotSummary current;
+    int32_t plateauSum;
+    uint32_t plateauCount;
+    ShotSummary last;
+    bool summaryPending;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+//
+// On-disk shot record, written by the firmware to SD and read by the host
+// tools in tools/shot_analytics. Little-endian, columnar so the host can
+// map a file and run straight over each channel:
+//
+//   ShotFileHeader                       headerSize bytes
+//   uint32_t time[sampleCount]           ms since startTime
+//   int16_t  channel0[sampleCount]       mbar (or the channel's unit)
+//   ...
+//   int16_t  channelN-1[sampleCount]
+//
+// Times are channel 0's. Channels 1 and up finish their conversions on their
+// own timestamps and are stored sample-and-hold: each row has the newest
+// sample taken at or before the row's time, so it may lag by one period.
+//
+
+#define SHOT_FILE_MAGIC 0x5453584d  // "MXST"
+#define SHOT_FILE_VERSION 2         // 2: shotNumber replaces the never-set unixTime
+#define SHOT_FILE_EXTENSION ".mxs"
+#define SHOT_FILE_GRINDER_UNKNOWN INT16_MIN
+
+struct __attribute__((packed)) ShotFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;        // readers skip unknown trailing fields
+    uint8_t deviceId[6];        // factory MAC
+    uint8_t channelCount;
+    uint8_t flags;
+    uint32_t bootCount;
+    uint32_t startTime;         // ms since boot
+    uint32_t shotNumber;        // per device, kept in NVS; with deviceId the shot's identity. 0 in version 1
+    uint16_t samplePeriodMs;    // nominal
+    int16_t grinderSetting;     // SHOT_FILE_GRINDER_UNKNOWN if not set
+    uint32_t sampleCount;
+
+    // Firmware's own ShotAnalyser summary, channel 0
+    uint32_t duration;          // ms
+    int16_t peakPressure;       // mbar
+    int16_t plateauMean;        // mbar
+    uint32_t timeToPeak;        // ms
+    uint32_t plateauTime;       // ms
+
+    uint8_t reserved[12];
+};
+
+static_assert(sizeof(ShotFileHeader) == 64, "ShotFileHeader is part of the file format");
@@ -0,0 +1,274 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <SD.h>
+#include <SPI.h>
+#include "shot_recorder.h"
+
+// Core2 microSD shares the LCD SPI bus
+#define SD_CS_PIN GPIO_NUM_4
+#define SD_SPI_FREQ 25000000
+
+ShotRecorder::ShotRecorder() {
+    channelCount = 0;
+    times = nullptr;
+    for (int i = 0; i < SHOT_RECORD_MAX_CHANNELS; i++) {
+        values[i] = nullptr;
+    }
+    count = 0;
+    startTime = 0;
+    recording = false;
+    cardMounted = false;
+    shotNumber = 0;
+    path[0] = '\0';
+    writing = false;
+    writeSection = 0;
+    writeOffset = 0;
+    written = 0;
+    preHead = 0;
+    preCount = 0;
+}
+
+bool ShotRecorder::begin(uint8_t channelCount) {
+    this->channelCount = min(channelCount, (uint8_t) SHOT_RECORD_MAX_CHANNELS);
+
+    times = (uint32_t *) ps_malloc(SHOT_RECORD_MAX_SAMPLES * sizeof(uint32_t));
+    for (int i = 0; i < this->channelCount; i++) {
+        values[i] = (int16_t *) ps_malloc(SHOT_RECORD_MAX_SAMPLES * sizeof(int16_t));
+    }
+
+    Preferences preferences;
+    if (preferences.begin(SHOT_RECORD_NAMESPACE, true)) {
+        shotNumber = preferences.getUInt("last", 0);
+        preferences.end();
+    }
+
+    bool allocated = times != nullptr;
+    for (int i = 0; i < this->channelCount; i++) {
+        allocated = allocated && values[i] != nullptr;
+    }
+    if (!allocated) {
+        Serial.println("Shot recorder: no PSRAM, recording disabled");
+        this->channelCount = 0;
+    }
+    return allocated;
+}
+
+void ShotRecorder::add(uint32_t time, const int16_t *values) {
+    if (channelCount == 0) {
+        return;
+    }
+
+    if (recording) {
+        append(time, values);
+        return;
+    }
+
+    uint8_t slot = (preHead + preCount) % SHOT_RECORD_PRE_SAMPLES;
+    if (preCount == SHOT_RECORD_PRE_SAMPLES) {
+        slot = preHead;
+        preHead = (preHead + 1) % SHOT_RECORD_PRE_SAMPLES;
+    } else {
+        preCount++;
+    }
+    preTimes[slot] = time;
+    memcpy(preValues[slot], values, channelCount * sizeof(int16_t));
+}
+
+// The analyser back-dates a shot to its last sample at rest, so the idle
+// history from that point on belongs to the shot as well
+void ShotRecorder::start(uint32_t startTime) {
+    if (channelCount == 0) {
+        return;
+    }
+
+    // The buffers are about to be reused, so a write still in flight from
+    // the previous shot has to land first. Shots are far enough apart that
+    // this only happens when the card is very slow
+    while (writing) {
+        poll();
+    }
+
+    this->startTime = startTime;
+    count = 0;
+    recording = true;
+
+    for (uint8_t i = 0; i < preCount; i++) {
+        uint8_t slot = (preHead + i) % SHOT_RECORD_PRE_SAMPLES;
+        if (int32_t(preTimes[slot] - startTime) >= 0) {
+            append(preTimes[slot], preValues[slot]);
+        }
+    }
+    preCount = 0;
+    preHead = 0;
+}
+
+bool ShotRecorder::isRecording() {
+    return recording;
+}
+
+void ShotRecorder::append(uint32_t time, const int16_t *sample) {
+    if (count >= SHOT_RECORD_MAX_SAMPLES) {
+        return;
+    }
+    times[count] = time - startTime;
+    for (uint8_t i = 0; i < channelCount; i++) {
+        values[i][count] = sample[i];
+    }
+    count++;
+}
+
+bool ShotRecorder::mountCard() {
+    if (!cardMounted) {
+        cardMounted = SD.begin(SD_CS_PIN, SPI, SD_SPI_FREQ);
+        if (cardMounted && !SD.exists(SHOT_RECORD_DIR)) {
+            SD.mkdir(SHOT_RECORD_DIR);
+        }
+    }
+    return cardMounted;
+}
+
+void ShotRecorder::finish(const ShotSummary &summary, uint16_t samplePeriodMs, int16_t grinderSetting, uint32_t bootCount) {
+    if (!recording) {
+        return;
+    }
+    recording = false;
+
+    if (count == 0) {
+        return;
+    }
+
+    header = {};
+    header.magic = SHOT_FILE_MAGIC;
+    header.version = SHOT_FILE_VERSION;
+    header.headerSize = sizeof(ShotFileHeader);
+    uint64_t mac = ESP.getEfuseMac();
+    memcpy(header.deviceId, &mac, sizeof(header.deviceId));
+    header.channelCount = channelCount;
+    header.bootCount = bootCount;
+    header.startTime = startTime;
+    header.samplePeriodMs = samplePeriodMs;
+    header.grinderSetting = grinderSetting;
+    header.sampleCount = count;
+    header.duration = summary.duration;
+    header.peakPressure = summary.peakPressure;
+    header.plateauMean = summary.plateauMean;
+    header.timeToPeak = summary.timeToPeak;
+    header.plateauTime = summary.plateauTime;
+
+    writing = true;
+    writeSection = 0;
+    writeOffset = 0;
+    written = 0;
+}
+
+bool ShotRecorder::isWriting() {
+    return writing;
+}
+
+// One step of the pending write per call: mounting and opening, a chunk of
+// at most SHOT_RECORD_WRITE_CHUNK bytes, or closing the file
+void ShotRecorder::poll() {
+    if (!writing) {
+        return;
+    }
+
+    if (!file) {
+        if (!openFile()) {
+            writing = false;
+        }
+        return;
+    }
+
+    if (!writeChunk()) {
+        closeFile();
+    }
+}
+
+// Takes the next shot number whose file does not exist yet and stores it
+// before anything is written. The check covers a counter that is behind the
+// card, after an NVS erase or with a card moved between devices, since
+// FILE_WRITE would truncate an earlier shot
+bool ShotRecorder::claimShotNumber() {
+    uint8_t tries = 0;
+    do {
+        if (++tries > SHOT_RECORD_NAME_TRIES) {
+            Serial.println("Shot recorder: no free file name");
+            return false;
+        }
+        shotNumber++;
+        snprintf(path, sizeof(path), SHOT_RECORD_DIR "/s%07lu" SHOT_FILE_EXTENSION, (unsigned long) shotNumber);
+    } while (SD.exists(path));
+
+    Preferences preferences;
+    if (preferences.begin(SHOT_RECORD_NAMESPACE, false)) {
+        preferences.putUInt("last", shotNumber);
+        preferences.end();
+    }
+    header.shotNumber = shotNumber;
+    return true;
+}
+
+bool ShotRecorder::openFile() {
+    if (!mountCard() || !claimShotNumber()) {
+        return false;
+    }
+
+    file = SD.open(path, FILE_WRITE);
+    if (!file) {
+        Serial.printf("Shot recorder: cannot create %s\r\n", path);
+        cardMounted = false;
+        return false;
+    }
+    return true;
+}
+
+const uint8_t *ShotRecorder::section(uint8_t index, size_t &length) {
+    if (index == 0) {
+        length = sizeof(header);
+        return (const uint8_t *) &header;
+    }
+    if (index == 1) {
+        length = count * sizeof(uint32_t);
+        return (const uint8_t *) times;
+    }
+    if (index < 2 + channelCount) {
+        length = count * sizeof(int16_t);
+        return (const uint8_t *) values[index - 2];
+    }
+    length = 0;
+    return nullptr;
+}
+
+// Returns false once every section is written or the card stops taking data
+bool ShotRecorder::writeChunk() {
+    size_t length;
+    const uint8_t *data = section(writeSection, length);
+    if (data == nullptr) {
+        return false;
+    }
+
+    size_t chunk = length - writeOffset;
+    if (chunk > SHOT_RECORD_WRITE_CHUNK) {
+        chunk = SHOT_RECORD_WRITE_CHUNK;
+    }
+    size_t result = file.write(data + writeOffset, chunk);
+    written += result;
+    if (result != chunk) {
+        return false;
+    }
+
+    writeOffset += chunk;
+    if (writeOffset == length) {
+        writeSection++;
+        writeOffset = 0;
+    }
+    return true;
+}
+
+void ShotRecorder::closeFile() {
+    file.close();
+    writing = false;
+
+    size_t expected = sizeof(header) + count * (sizeof(uint32_t) + channelCount * sizeof(int16_t));
+    Serial.printf("Shot recorder: %s, %lu samples%s\r\n", path, (unsigned long) count, written == expected ? "" : " (short write)");
+}
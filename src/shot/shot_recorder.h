@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include "shot_analyser.h"
+#include "shot_file.h"
+
+#define SHOT_RECORD_MAX_CHANNELS 4
+#define SHOT_RECORD_MAX_SAMPLES 6000    // two minutes at 20 ms
+#define SHOT_RECORD_PRE_SAMPLES 32      // history kept while idle, covers a back-dated start
+#define SHOT_RECORD_DIR "/shots"
+#define SHOT_RECORD_NAMESPACE "mxshots"  // NVS, holds the last shot number
+#define SHOT_RECORD_NAME_TRIES 64       // free names probed past a stale NVS counter
+#define SHOT_RECORD_WRITE_CHUNK 4096   // bytes per poll(), keeps a loop pass short
+
+//
+// Buffers every channel of a shot in PSRAM and writes it to SD as a
+// ShotFileHeader + columnar sample file once the shot is over. The SD card
+// shares the SPI bus with the LCD, so the file is written from loop() in
+// chunks by poll() rather than in one blocking call
+//
+class ShotRecorder {
+  public:
+    ShotRecorder();
+    bool begin(uint8_t channelCount);
+
+    void add(uint32_t time, const int16_t *values);
+    void start(uint32_t startTime);
+    void finish(const ShotSummary &summary, uint16_t samplePeriodMs, int16_t grinderSetting, uint32_t bootCount);
+    void poll();
+    bool isRecording();
+    bool isWriting();
+
+  private:
+    void append(uint32_t time, const int16_t *values);
+    bool mountCard();
+    bool claimShotNumber();
+    bool openFile();
+    bool writeChunk();
+    void closeFile();
+    const uint8_t *section(uint8_t index, size_t &length);
+
+    uint8_t channelCount;
+    uint32_t *times;
+    int16_t *values[SHOT_RECORD_MAX_CHANNELS];
+    uint32_t count;
+    uint32_t startTime;
+    bool recording;
+    bool cardMounted;
+    uint32_t shotNumber;   // last one used, survives power cycles unlike the boot count
+
+    // Pending write, sections are the header, times, then one per channel
+    ShotFileHeader header;
+    File file;
+    char path[48];
+    bool writing;
+    uint8_t writeSection;
+    size_t writeOffset;
+    size_t written;
+
+    uint32_t preTimes[SHOT_RECORD_PRE_SAMPLES];
+    int16_t preValues[SHOT_RECORD_PRE_SAMPLES][SHOT_RECORD_MAX_CHANNELS];
+    uint8_t preHead;
+    uint8_t preCount;
+};
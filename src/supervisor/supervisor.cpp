@@ -0,0 +1,257 @@
+#include <Arduino.h>
+#include <esp_attr.h>
+#include "supervisor.h"
+
+#define OVERRUN_LOG_MAGIC 0x4d584f56UL  // "MXOV"
+
+// RTC slow memory is left alone by panics, watchdog and software resets;
+// a power cycle leaves garbage, which the magic and checksum reject
+struct OverrunLog {
+    uint32_t magic;
+    uint32_t bootCount;
+    uint8_t head;
+    uint8_t count;
+    OverrunRecord records[SUPERVISOR_OVERRUN_LOG_LEN];
+    uint32_t checksum;
+};
+
+RTC_NOINIT_ATTR static OverrunLog overrunLog;
+
+static uint32_t overrunLogChecksum() {
+    const uint8_t *bytes = (const uint8_t *) &overrunLog;
+    uint32_t sum = 0x811c9dc5UL;
+    for (size_t i = 0; i < offsetof(OverrunLog, checksum); i++) {
+        sum = (sum ^ bytes[i]) * 0x01000193UL;
+    }
+    return sum;
+}
+
+Supervisor::Supervisor() {
+    taskCount = 0;
+    busRecoveryRequested.store(false);
+}
+
+void Supervisor::begin() {
+    if (overrunLog.magic != OVERRUN_LOG_MAGIC || overrunLog.checksum != overrunLogChecksum()
+        || overrunLog.head >= SUPERVISOR_OVERRUN_LOG_LEN || overrunLog.count > SUPERVISOR_OVERRUN_LOG_LEN) {
+        memset(&overrunLog, 0, sizeof(overrunLog));
+        overrunLog.magic = OVERRUN_LOG_MAGIC;
+    }
+    overrunLog.bootCount++;
+    overrunLog.checksum = overrunLogChecksum();
+
+    xTaskCreatePinnedToCore(Supervisor::taskMain, "supervisor", 3072, this, 2, nullptr, 0);
+}
+
+int8_t Supervisor::registerTask(const char *name, uint32_t budgetMs) {
+    if (taskCount >= SUPERVISOR_MAX_TASKS) {
+        return -1;
+    }
+    SupervisedTask &task = tasks[taskCount];
+    task = {};
+    task.name = name;
+    task.budgetMs = budgetMs;
+    return taskCount++;
+}
+
+void Supervisor::setBudget(int8_t task, uint32_t budgetMs) {
+    if (task >= 0 && task < taskCount) {
+        tasks[task].budgetMs = budgetMs;
+    }
+}
+
+void Supervisor::enter(int8_t task, SupervisorStage stage) {
+    if (task < 0 || task >= taskCount) {
+        return;
+    }
+    SupervisedTask &t = tasks[task];
+    uint32_t now = millis();
+    uint32_t elapsed = now - t.stageStart;
+
+    portENTER_CRITICAL(&lock);
+    if (elapsed > t.worstStageTime) {
+        t.worstStage = t.stage;
+        t.worstStageTime = elapsed;
+    }
+    t.stage = stage;
+    t.stageStart = now;
+    portEXIT_CRITICAL(&lock);
+}
+
+void Supervisor::heartbeat(int8_t task) {
+    if (task < 0 || task >= taskCount) {
+        return;
+    }
+    enter(task, STAGE_NONE);
+
+    SupervisedTask &t = tasks[task];
+    uint32_t now = millis();
+    uint32_t gap = now - t.lastHeartbeat;
+
+    if (t.lastHeartbeat != 0 && gap > t.budgetMs) {
+        t.misses++;
+        t.worstGap = max(t.worstGap, gap);
+
+        OverrunRecord overrun = {};
+        overrun.time = now;
+        overrun.duration = gap;
+        overrun.stageTime = t.worstStageTime;
+        overrun.task = task;
+        overrun.stage = t.worstStage;
+        overrun.kind = OVERRUN_DEADLINE;
+        record(overrun);
+    }
+
+    portENTER_CRITICAL(&lock);
+    t.lastHeartbeat = now;
+    t.worstStage = STAGE_NONE;
+    t.worstStageTime = 0;
+    t.stallReported = false;
+    portEXIT_CRITICAL(&lock);
+}
+
+void Supervisor::rearm(int8_t task) {
+    if (task < 0 || task >= taskCount) {
+        return;
+    }
+    SupervisedTask &t = tasks[task];
+
+    portENTER_CRITICAL(&lock);
+    if (t.lastHeartbeat != 0) {
+        t.lastHeartbeat = millis();
+    }
+    t.worstStage = STAGE_NONE;
+    t.worstStageTime = 0;
+    t.stallReported = false;
+    portEXIT_CRITICAL(&lock);
+}
+
+bool Supervisor::takeBusRecoveryRequest() {
+    return busRecoveryRequested.exchange(false);
+}
+
+void Supervisor::recordBusReset(int8_t task, bool recovered) {
+    OverrunRecord overrun = {};
+    overrun.time = millis();
+    overrun.task = task;
+    overrun.stage = STAGE_SAMPLE;
+    overrun.kind = OVERRUN_BUS_RESET;
+    overrun.duration = recovered ? 0 : UINT32_MAX;
+    record(overrun);
+    Serial.printf("Supervisor: I2C bus reset, %s\r\n", recovered ? "recovered" : "SDA still low");
+}
+
+void Supervisor::taskMain(void *param) {
+    Supervisor *self = (Supervisor *) param;
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(SUPERVISOR_CHECK_MS));
+        self->check();
+    }
+}
+
+// Runs on the other core, so it still sees a loop that never returns from
+// an I2C transaction or a display push
+void Supervisor::check() {
+    uint32_t now = millis();
+
+    for (uint8_t i = 0; i < taskCount; i++) {
+        SupervisedTask &t = tasks[i];
+
+        portENTER_CRITICAL(&lock);
+        uint32_t lastHeartbeat = t.lastHeartbeat;
+        uint8_t stage = t.stage;
+        uint32_t stageStart = t.stageStart;
+        bool reported = t.stallReported;
+        portEXIT_CRITICAL(&lock);
+
+        uint32_t stallLimit = max(t.budgetMs * 10, (uint32_t) SUPERVISOR_STALL_MIN_MS);
+        if (lastHeartbeat == 0 || reported || now - lastHeartbeat <= stallLimit) {
+            continue;
+        }
+        t.stallReported = true;
+
+        OverrunRecord overrun = {};
+        overrun.time = now;
+        overrun.duration = now - lastHeartbeat;
+        overrun.stageTime = now - stageStart;
+        overrun.task = i;
+        overrun.stage = stage;
+        overrun.kind = OVERRUN_STALL;
+        record(overrun);
+        Serial.printf("Supervisor: %s stalled in %s for %lu ms\r\n", t.name, stageName(stage), (unsigned long) overrun.stageTime);
+
+        // A slave holding SDA low makes every transaction time out. Touching
+        // the driver from this core would race the transaction in flight,
+        // so only flag it; loop() recovers once the stuck call returns
+        if (stage == STAGE_SAMPLE) {
+            busRecoveryRequested.store(true);
+        }
+    }
+}
+
+void Supervisor::record(const OverrunRecord &overrun) {
+    portENTER_CRITICAL(&lock);
+    OverrunRecord &slot = overrunLog.records[overrunLog.head];
+    slot = overrun;
+    slot.bootCount = overrunLog.bootCount;
+    overrunLog.head = (overrunLog.head + 1) % SUPERVISOR_OVERRUN_LOG_LEN;
+    if (overrunLog.count < SUPERVISOR_OVERRUN_LOG_LEN) {
+        overrunLog.count++;
+    }
+    overrunLog.checksum = overrunLogChecksum();
+    portEXIT_CRITICAL(&lock);
+}
+
+uint32_t Supervisor::getMisses(int8_t task) {
+    return (task >= 0 && task < taskCount) ? tasks[task].misses : 0;
+}
+
+uint32_t Supervisor::getWorstGap(int8_t task) {
+    return (task >= 0 && task < taskCount) ? tasks[task].worstGap : 0;
+}
+
+uint8_t Supervisor::getOverrunCount() {
+    return overrunLog.count;
+}
+
+bool Supervisor::getOverrun(uint8_t age, OverrunRecord &overrun) {
+    if (age >= overrunLog.count) {
+        return false;
+    }
+    portENTER_CRITICAL(&lock);
+    uint8_t index = (overrunLog.head + SUPERVISOR_OVERRUN_LOG_LEN - 1 - age) % SUPERVISOR_OVERRUN_LOG_LEN;
+    overrun = overrunLog.records[index];
+    portEXIT_CRITICAL(&lock);
+    return true;
+}
+
+uint32_t Supervisor::getBootCount() {
+    return overrunLog.bootCount;
+}
+
+void Supervisor::printOverruns() {
+    static const char *kinds[] = {"deadline", "stall", "bus reset"};
+    OverrunRecord overrun;
+
+    Serial.printf("Supervisor: boot %lu, %d overruns logged\r\n", (unsigned long) overrunLog.bootCount, overrunLog.count);
+    for (uint8_t age = 0; getOverrun(age, overrun); age++) {
+        Serial.printf("  boot %lu @%lu ms: %s task %d, %lu ms, %s %lu ms\r\n",
+            (unsigned long) overrun.bootCount, (unsigned long) overrun.time,
+            overrun.kind <= OVERRUN_BUS_RESET ? kinds[overrun.kind] : "?", overrun.task,
+            (unsigned long) overrun.duration, stageName(overrun.stage), (unsigned long) overrun.stageTime);
+    }
+}
+
+const char *Supervisor::stageName(uint8_t stage) {
+    switch (stage) {
+        case STAGE_NONE: return "idle";
+        case STAGE_INPUT: return "input";
+        case STAGE_SAMPLE: return "sample";
+        case STAGE_ANALYSE: return "analyse";
+        case STAGE_BLE: return "ble";
+        case STAGE_DRAW: return "draw";
+        case STAGE_BLE_INIT: return "ble init";
+        case STAGE_STORAGE: return "storage";
+    }
+    return "?";
+}
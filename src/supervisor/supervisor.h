@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+#define SUPERVISOR_MAX_TASKS 4
+#define SUPERVISOR_OVERRUN_LOG_LEN 16
+#define SUPERVISOR_CHECK_MS 50
+#define SUPERVISOR_STALL_MIN_MS 1000
+
+enum SupervisorStage : uint8_t {
+    STAGE_NONE,
+    STAGE_INPUT,
+    STAGE_SAMPLE,
+    STAGE_ANALYSE,
+    STAGE_BLE,
+    STAGE_DRAW,
+    STAGE_BLE_INIT,
+    STAGE_STORAGE,
+    STAGE_COUNT
+};
+
+enum OverrunKind : uint8_t {
+    OVERRUN_DEADLINE,   // heartbeat came late
+    OVERRUN_STALL,      // no heartbeat at all, reported by the supervisor task
+    OVERRUN_BUS_RESET   // I2C bus recovered
+};
+
+struct OverrunRecord {
+    uint32_t bootCount;
+    uint32_t time;       // ms since that boot
+    uint32_t duration;   // ms, heartbeat gap
+    uint32_t stageTime;  // ms spent in the blamed stage
+    uint8_t task;
+    uint8_t stage;
+    uint8_t kind;
+};
+
+struct SupervisedTask {
+    const char *name;
+    uint32_t budgetMs;
+    volatile uint32_t lastHeartbeat;
+    volatile uint8_t stage;
+    volatile uint32_t stageStart;
+    uint8_t worstStage;       // longest stage since the last heartbeat
+    uint32_t worstStageTime;
+    bool stallReported;
+    uint32_t misses;
+    uint32_t worstGap;
+};
+
+//
+// Heartbeat/deadline supervisor. Tasks mark the stage they are in and beat
+// once per cycle; a late beat is a deadline miss blamed on the longest stage
+// of that cycle. A separate task catches beats that never come. Overruns go
+// to a ring in RTC memory that survives a panic or software reset.
+//
+class Supervisor {
+  public:
+    Supervisor();
+    void begin();
+
+    int8_t registerTask(const char *name, uint32_t budgetMs);
+    void setBudget(int8_t task, uint32_t budgetMs);
+    void enter(int8_t task, SupervisorStage stage);
+    void heartbeat(int8_t task);
+    // Restarts the deadline without checking it, for a budget that just
+    // shrank while the cycle in flight was still paced by the old one
+    void rearm(int8_t task);
+
+    // Set by the supervisor task when a task hangs in STAGE_SAMPLE. The bus
+    // and SensorBus belong to loop(), so loop() does the recovery itself.
+    bool takeBusRecoveryRequest();
+    void recordBusReset(int8_t task, bool recovered);
+
+    uint32_t getMisses(int8_t task);
+    uint32_t getWorstGap(int8_t task);
+    uint8_t getOverrunCount();
+    bool getOverrun(uint8_t age, OverrunRecord &record);  // 0 = newest
+    uint32_t getBootCount();
+    void printOverruns();
+
+    static const char *stageName(uint8_t stage);
+
+  private:
+    static void taskMain(void *param);
+    void check();
+    void record(const OverrunRecord &record);
+
+    SupervisedTask tasks[SUPERVISOR_MAX_TASKS];
+    uint8_t taskCount;
+    std::atomic<bool> busRecoveryRequested;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+};
@@ -0,0 +1,16 @@
+#include <chrono>
+#include <cstdio>
+#include "bench/dsp_bench.h"
+
+static void printLine(const char *line) {
+    printf("%s\n", line);
+}
+
+static uint32_t clockMicros() {
+    using namespace std::chrono;
+    return uint32_t(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+int main() {
+    return runDspBench(printLine, clockMicros) ? 0 : 1;
+}
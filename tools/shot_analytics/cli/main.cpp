@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "shot_curves.h"
+#include "shot_file_view.h"
+#include "shot_metrics.h"
+#include "thread_pool.h"
+
+//
+// mxshot: batch metrics and per-grinder percentile curves over shot files
+//
+
+namespace fs = std::filesystem;
+
+static void usage() {
+    fprintf(stderr,
+            "usage: mxshot [options] <file.mxs | directory>...\n"
+            "  -j N             worker threads (default: all cores)\n"
+            "  -m FILE          per-shot metrics CSV (default: stdout)\n"
+            "  -c FILE          percentile curves CSV, one row per grinder setting and bin\n"
+            "  -p LIST          curve percentiles, default 10,50,90\n"
+            "  --bin MS         curve resolution, default 100\n"
+            "  --max MS         curve length, default 60000\n"
+            "  --channel N      channel to analyse, default 0\n");
+}
+
+static bool parseUnsigned(const char *text, unsigned long &value) {
+    char *end;
+    value = strtoul(text, &end, 10);
+    return *text != '\0' && *end == '\0';
+}
+
+static bool parsePercentiles(const char *text, std::vector<double> &percentiles) {
+    percentiles.clear();
+    std::string list(text);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        std::string item = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        char *end;
+        double p = strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || p < 0 || p > 100) {
+            return false;
+        }
+        percentiles.push_back(p);
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return !percentiles.empty();
+}
+
+static void collect(const fs::path &path, std::vector<std::string> &files) {
+    std::error_code error;
+    if (!fs::is_directory(path, error)) {
+        files.push_back(path.string());
+        return;
+    }
+
+    size_t first = files.size();
+    for (fs::recursive_directory_iterator it(path, error), end; it != end; it.increment(error)) {
+        if (error) {
+            break;
+        }
+        if (it->is_regular_file(error) && it->path().extension() == SHOT_FILE_EXTENSION) {
+            files.push_back(it->path().string());
+        }
+    }
+    if (error) {
+        fprintf(stderr, "mxshot: %s: %s\n", path.c_str(), error.message().c_str());
+    }
+    std::sort(files.begin() + first, files.end());
+}
+
+static FILE *openOutput(const char *path) {
+    if (path == nullptr) {
+        return stdout;
+    }
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) {
+        fprintf(stderr, "mxshot: %s: %s\n", path, strerror(errno));
+    }
+    return file;
+}
+
+static void writeMetrics(FILE *out, const std::vector<ShotFileView> &shots, const std::vector<ShotMetrics> &metrics) {
+    fprintf(out, "file,device,shot,boot,start_ms,grinder,samples,duration_ms,peak_mbar,time_to_peak_ms,"
+                 "ramp_ms,plateau_mean_mbar,plateau_stddev_mbar,plateau_ms\n");
+    for (size_t i = 0; i < shots.size(); i++) {
+        if (!shots[i].isOpen() || !metrics[i].valid) {
+            continue;
+        }
+        const ShotFileHeader &header = shots[i].getHeader();
+        const ShotMetrics &m = metrics[i];
+
+        char grinder[8] = "";
+        if (header.grinderSetting != SHOT_FILE_GRINDER_UNKNOWN) {
+            snprintf(grinder, sizeof(grinder), "%d", header.grinderSetting);
+        }
+        fprintf(out, "%s,%02x%02x%02x%02x%02x%02x,%u,%u,%u,%s,%u,%u,%d,%u,%u,%d,%.1f,%u\n",
+                shots[i].getPath().c_str(),
+                header.deviceId[0], header.deviceId[1], header.deviceId[2],
+                header.deviceId[3], header.deviceId[4], header.deviceId[5],
+                header.shotNumber, header.bootCount, header.startTime, grinder,
+                m.sampleCount, m.duration, m.peakPressure, m.timeToPeak,
+                m.rampTime, m.plateauMean, m.plateauStdDev, m.plateauTime);
+    }
+}
+
+static void writeCurves(FILE *out, const std::vector<PercentileCurve> &curves, const CurveOptions &options) {
+    fprintf(out, "grinder,shots,time_ms,bin_shots");
+    for (double p : options.percentiles) {
+        fprintf(out, ",p%g_mbar", p);
+    }
+    fprintf(out, "\n");
+
+    for (const auto &curve : curves) {
+        char grinder[8] = "";
+        if (curve.grinderSetting != SHOT_FILE_GRINDER_UNKNOWN) {
+            snprintf(grinder, sizeof(grinder), "%d", curve.grinderSetting);
+        }
+        for (size_t bin = 0; bin < curve.binShots.size(); bin++) {
+            if (curve.binShots[bin] == 0) {
+                continue;
+            }
+            fprintf(out, "%s,%u,%lu,%u", grinder, curve.shotCount,
+                    (unsigned long) (bin * options.binMs), curve.binShots[bin]);
+            for (const auto &values : curve.values) {
+                fprintf(out, ",%d", values[bin]);
+            }
+            fprintf(out, "\n");
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    unsigned long threadCount = 0;
+    const char *metricsPath = nullptr;
+    const char *curvesPath = nullptr;
+    CurveOptions curveOptions;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        unsigned long value;
+
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        } else if (arg == "-j" && hasValue && parseUnsigned(argv[i + 1], value)) {
+            threadCount = value;
+            i++;
+        } else if (arg == "-m" && hasValue) {
+            metricsPath = argv[++i];
+        } else if (arg == "-c" && hasValue) {
+            curvesPath = argv[++i];
+        } else if (arg == "-p" && hasValue && parsePercentiles(argv[i + 1], curveOptions.percentiles)) {
+            i++;
+        } else if (arg == "--bin" && hasValue && parseUnsigned(argv[i + 1], value) && value > 0) {
+            curveOptions.binMs = uint32_t(value);
+            i++;
+        } else if (arg == "--max" && hasValue && parseUnsigned(argv[i + 1], value)) {
+            curveOptions.maxMs = uint32_t(value);
+            i++;
+        } else if (arg == "--channel" && hasValue && parseUnsigned(argv[i + 1], value) && value < 256) {
+            curveOptions.channel = uint8_t(value);
+            i++;
+        } else if (!arg.empty() && arg[0] == '-') {
+            fprintf(stderr, "mxshot: bad option %s\n", arg.c_str());
+            usage();
+            return 2;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (inputs.empty()) {
+        usage();
+        return 2;
+    }
+
+    std::vector<std::string> files;
+    for (const auto &input : inputs) {
+        collect(input, files);
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    ThreadPool pool(static_cast<unsigned>(threadCount));
+
+    // Mapping is cheap, but thousands of opens still add up on a cold cache
+    std::vector<ShotFileView> shots(files.size());
+    std::vector<ShotMetrics> metrics(files.size());
+    pool.parallelFor(files.size(), [&](size_t i) {
+        if (shots[i].open(files[i])) {
+            metrics[i] = computeShotMetrics(shots[i], curveOptions.channel);
+        }
+    }, 16);
+
+    std::vector<const ShotFileView *> valid;
+    size_t failed = 0;
+    for (size_t i = 0; i < shots.size(); i++) {
+        if (!shots[i].isOpen()) {
+            fprintf(stderr, "mxshot: %s: %s\n", files[i].c_str(), shots[i].getError().c_str());
+            failed++;
+        } else if (metrics[i].valid) {
+            valid.push_back(&shots[i]);
+        }
+    }
+
+    FILE *metricsOut = openOutput(metricsPath);
+    if (metricsOut == nullptr) {
+        return 1;
+    }
+    writeMetrics(metricsOut, shots, metrics);
+    if (metricsOut != stdout) {
+        fclose(metricsOut);
+    }
+
+    if (curvesPath != nullptr) {
+        FILE *curvesOut = openOutput(curvesPath);
+        if (curvesOut == nullptr) {
+            return 1;
+        }
+        writeCurves(curvesOut, computePercentileCurves(valid, curveOptions, pool), curveOptions);
+        fclose(curvesOut);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    fprintf(stderr, "mxshot: %zu shots (%zu unreadable, %zu without a shot) in %.3f s on %u threads\n",
+            shots.size(), failed, shots.size() - failed - valid.size(), seconds, pool.size());
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "shot_file_view.h"
+#include "thread_pool.h"
+
+//
+// Percentile pressure curves per grinder setting. Every shot is resampled
+// onto a common time grid (sample-and-hold), then each bin takes the
+// requested percentiles over the shots still running at that time.
+//
+
+struct CurveOptions {
+    uint32_t binMs = 100;
+    uint32_t maxMs = 60000;
+    std::vector<double> percentiles = { 10, 50, 90 };
+    uint8_t channel = 0;
+};
+
+struct PercentileCurve {
+    int16_t grinderSetting;
+    uint32_t shotCount;
+    std::vector<uint32_t> binShots;             // shots contributing to each bin
+    std::vector<std::vector<int16_t>> values;   // [percentile][bin], mbar
+};
+
+// Curves sorted by grinder setting; bins past the longest shot are trimmed
+std::vector<PercentileCurve> computePercentileCurves(const std::vector<const ShotFileView *> &shots,
+                                                     const CurveOptions &options, ThreadPool &pool);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "shot_file.h"
+
+//
+// Read-only memory-mapped view of one shot file. Sample arrays point
+// straight into the mapping; nothing is copied.
+//
+class ShotFileView {
+  public:
+    ShotFileView() = default;
+    ~ShotFileView();
+    ShotFileView(ShotFileView &&other) noexcept;
+    ShotFileView &operator=(ShotFileView &&other) noexcept;
+    ShotFileView(const ShotFileView &) = delete;
+    ShotFileView &operator=(const ShotFileView &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const;
+
+    const std::string &getPath() const;
+    const std::string &getError() const;
+    const ShotFileHeader &getHeader() const;
+    uint32_t getSampleCount() const;
+    uint8_t getChannelCount() const;
+    const uint32_t *getTimes() const;               // ms since shot start
+    const int16_t *getChannel(uint8_t channel) const;
+
+  private:
+    bool fail(const std::string &error);
+
+    std::string path;
+    std::string error;
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+    const ShotFileHeader *header = nullptr;
+    const uint32_t *times = nullptr;
+    const int16_t *channels = nullptr;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "shot_file_view.h"
+
+//
+// Per-shot metrics, recomputed from the raw samples rather than taken from
+// the firmware's streaming summary, so they stay comparable across firmware
+// versions. Thresholds are fractions of the shot's own peak.
+//
+
+struct ShotMetrics {
+    bool valid;
+    uint32_t sampleCount;
+    uint32_t duration;          // ms, first sample to last one above SHOT_END_PRESSURE
+    int16_t peakPressure;       // mbar
+    uint32_t timeToPeak;        // ms
+    uint32_t rampTime;          // ms, 10% to 90% of peak
+    int16_t plateauMean;        // mbar, 0 without a plateau
+    float plateauStdDev;        // mbar, pressure stability over the plateau
+    uint32_t plateauTime;       // ms, first 90% crossing to last sample above 80%
+};
+
+#define SHOT_END_PRESSURE 500   // mbar, same as the firmware analyser
+
+ShotMetrics computeShotMetrics(const ShotFileView &shot, uint8_t channel = 0);
+
+// Vectorisable building blocks, exposed for the curve code
+int16_t findMax(const int16_t *values, size_t count);
+size_t findFirstAtLeast(const int16_t *values, size_t count, int16_t threshold);  // count if none
+size_t findLastAtLeast(const int16_t *values, size_t count, int16_t threshold);   // count if none
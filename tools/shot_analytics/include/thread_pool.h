@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Work-stealing thread pool. Each worker owns a deque: it pushes and pops
+// its own work at the back (newest first, still warm in cache) and idle
+// workers steal from the front of the others (oldest, usually the largest
+// remaining piece).
+//
+class ThreadPool {
+  public:
+    explicit ThreadPool(unsigned threadCount = 0);  // 0: one per hardware thread
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned size() const;
+
+    void submit(std::function<void()> task);
+    void wait();  // until every submitted task has run
+
+    // Runs body(i) for i in [0, count) in chunks of grain and returns when
+    // all have run. The calling thread helps, so it may be nested in a task.
+    void parallelFor(size_t count, const std::function<void(size_t)> &body, size_t grain = 1);
+
+  private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void push(std::function<void()> task);
+    bool popLocal(unsigned index, std::function<void()> &task);
+    bool steal(unsigned thief, std::function<void()> &task);
+    bool runOne();
+    void run(unsigned index);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::atomic<size_t> queued{0};    // tasks sitting in a deque
+    std::atomic<size_t> pending{0};   // submitted and not finished
+    std::atomic<unsigned> nextWorker{0};
+    std::atomic<bool> stopping{false};
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+};
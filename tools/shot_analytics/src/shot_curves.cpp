@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include "shot_curves.h"
+
+#define NO_SAMPLE INT16_MIN
+
+// One walk over the samples: bin b takes the last sample at or before
+// b * binMs. Bins after the shot's last sample stay NO_SAMPLE
+static void resample(const ShotFileView &shot, uint8_t channel, uint32_t binMs, std::vector<int16_t> &bins) {
+    std::fill(bins.begin(), bins.end(), NO_SAMPLE);
+
+    const uint32_t *times = shot.getTimes();
+    const int16_t *values = shot.getChannel(channel);
+    size_t count = shot.getSampleCount();
+    if (values == nullptr || count == 0) {
+        return;
+    }
+
+    size_t sample = 0;
+    uint32_t lastTime = times[count - 1];
+    for (size_t bin = 0; bin < bins.size(); bin++) {
+        uint32_t t = uint32_t(bin) * binMs;
+        if (t > lastTime) {
+            break;
+        }
+        while (sample + 1 < count && times[sample + 1] <= t) {
+            sample++;
+        }
+        bins[bin] = values[sample];
+    }
+}
+
+// Linear interpolation between closest ranks, on a scratch copy that
+// nth_element is free to reorder
+static int16_t percentile(std::vector<int16_t> &values, double p) {
+    double rank = p / 100.0 * double(values.size() - 1);
+    size_t lower = size_t(rank);
+    std::nth_element(values.begin(), values.begin() + lower, values.end());
+    double low = values[lower];
+    if (lower + 1 >= values.size()) {
+        return int16_t(low);
+    }
+
+    // After nth_element the next rank is the minimum of the upper part
+    double high = *std::min_element(values.begin() + lower + 1, values.end());
+    return int16_t(std::lround(low + (high - low) * (rank - double(lower))));
+}
+
+std::vector<PercentileCurve> computePercentileCurves(const std::vector<const ShotFileView *> &shots,
+                                                     const CurveOptions &options, ThreadPool &pool) {
+    uint32_t binMs = std::max<uint32_t>(options.binMs, 1);
+    size_t binCount = options.maxMs / binMs + 1;
+
+    // Resampled shots, one row each, so the percentile pass reads a column
+    // of small fixed-size rows instead of chasing the mapped files
+    std::vector<std::vector<int16_t>> grid(shots.size(), std::vector<int16_t>(binCount));
+    pool.parallelFor(shots.size(), [&](size_t i) {
+        resample(*shots[i], options.channel, binMs, grid[i]);
+    });
+
+    std::map<int16_t, std::vector<size_t>> groups;
+    for (size_t i = 0; i < shots.size(); i++) {
+        groups[shots[i]->getHeader().grinderSetting].push_back(i);
+    }
+
+    std::vector<PercentileCurve> curves;
+    std::vector<const std::vector<size_t> *> members;
+    for (const auto &group : groups) {
+        PercentileCurve curve;
+        curve.grinderSetting = group.first;
+        curve.shotCount = uint32_t(group.second.size());
+        curve.binShots.assign(binCount, 0);
+        curve.values.assign(options.percentiles.size(), std::vector<int16_t>(binCount, NO_SAMPLE));
+        curves.push_back(std::move(curve));
+        members.push_back(&group.second);
+    }
+
+    // Each (grinder, bin) cell is independent; chunks of bins keep the
+    // scratch buffer and the rows they touch in cache
+    size_t binGrain = 64;
+    size_t chunksPerCurve = (binCount + binGrain - 1) / binGrain;
+    pool.parallelFor(curves.size() * chunksPerCurve, [&](size_t task) {
+        PercentileCurve &curve = curves[task / chunksPerCurve];
+        const std::vector<size_t> &shotIndexes = *members[task / chunksPerCurve];
+        size_t begin = (task % chunksPerCurve) * binGrain;
+        size_t end = std::min(begin + binGrain, binCount);
+
+        std::vector<int16_t> column;
+        std::vector<int16_t> scratch;
+        column.reserve(shotIndexes.size());
+        for (size_t bin = begin; bin < end; bin++) {
+            column.clear();
+            for (size_t shot : shotIndexes) {
+                if (grid[shot][bin] != NO_SAMPLE) {
+                    column.push_back(grid[shot][bin]);
+                }
+            }
+            curve.binShots[bin] = uint32_t(column.size());
+            if (column.empty()) {
+                continue;
+            }
+            for (size_t p = 0; p < options.percentiles.size(); p++) {
+                scratch = column;
+                curve.values[p][bin] = percentile(scratch, options.percentiles[p]);
+            }
+        }
+    });
+
+    for (auto &curve : curves) {
+        size_t used = binCount;
+        while (used > 0 && curve.binShots[used - 1] == 0) {
+            used--;
+        }
+        curve.binShots.resize(used);
+        for (auto &values : curve.values) {
+            values.resize(used);
+        }
+    }
+    return curves;
+}
@@ -0,0 +1,148 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include "shot_file_view.h"
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "shot files are little-endian and mapped as-is");
+
+ShotFileView::~ShotFileView() {
+    close();
+}
+
+ShotFileView::ShotFileView(ShotFileView &&other) noexcept {
+    *this = std::move(other);
+}
+
+ShotFileView &ShotFileView::operator=(ShotFileView &&other) noexcept {
+    if (this != &other) {
+        close();
+        path = std::move(other.path);
+        error = std::move(other.error);
+        mapping = other.mapping;
+        mappingSize = other.mappingSize;
+        header = other.header;
+        times = other.times;
+        channels = other.channels;
+        other.mapping = nullptr;
+        other.mappingSize = 0;
+        other.header = nullptr;
+        other.times = nullptr;
+        other.channels = nullptr;
+    }
+    return *this;
+}
+
+bool ShotFileView::open(const std::string &path) {
+    close();
+    this->path = path;
+    error.clear();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return fail(std::strerror(errno));
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        int err = errno;
+        ::close(fd);
+        return fail(std::strerror(err));
+    }
+    if (size_t(info.st_size) < sizeof(ShotFileHeader)) {
+        ::close(fd);
+        return fail("too short for a shot header");
+    }
+
+    mappingSize = size_t(info.st_size);
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // the mapping keeps the file alive
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        mappingSize = 0;
+        return fail(std::strerror(errno));
+    }
+    // The advice values are an enum, not flags, so each needs its own call
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+    madvise(mapping, mappingSize, MADV_WILLNEED);
+
+    header = static_cast<const ShotFileHeader *>(mapping);
+    if (header->magic != SHOT_FILE_MAGIC) {
+        return fail("not a shot file");
+    }
+    // Version 1 only differs in a field that was always 0
+    if (header->version == 0 || header->version > SHOT_FILE_VERSION) {
+        return fail("unsupported shot file version " + std::to_string(header->version));
+    }
+    if (header->headerSize < sizeof(ShotFileHeader) || header->headerSize % sizeof(uint32_t) != 0) {
+        return fail("bad header size");
+    }
+    if (header->channelCount == 0) {
+        return fail("no channels");
+    }
+
+    size_t expected = size_t(header->headerSize)
+        + size_t(header->sampleCount) * (sizeof(uint32_t) + header->channelCount * sizeof(int16_t));
+    if (mappingSize < expected) {
+        return fail("truncated: " + std::to_string(mappingSize) + " of " + std::to_string(expected) + " bytes");
+    }
+
+    const uint8_t *base = static_cast<const uint8_t *>(mapping);
+    times = reinterpret_cast<const uint32_t *>(base + header->headerSize);
+    channels = reinterpret_cast<const int16_t *>(times + header->sampleCount);
+    return true;
+}
+
+void ShotFileView::close() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+    times = nullptr;
+    channels = nullptr;
+}
+
+bool ShotFileView::isOpen() const {
+    return times != nullptr;
+}
+
+const std::string &ShotFileView::getPath() const {
+    return path;
+}
+
+const std::string &ShotFileView::getError() const {
+    return error;
+}
+
+const ShotFileHeader &ShotFileView::getHeader() const {
+    return *header;
+}
+
+uint32_t ShotFileView::getSampleCount() const {
+    return header->sampleCount;
+}
+
+uint8_t ShotFileView::getChannelCount() const {
+    return header->channelCount;
+}
+
+const uint32_t *ShotFileView::getTimes() const {
+    return times;
+}
+
+const int16_t *ShotFileView::getChannel(uint8_t channel) const {
+    if (channel >= header->channelCount) {
+        return nullptr;
+    }
+    return channels + size_t(channel) * header->sampleCount;
+}
+
+bool ShotFileView::fail(const std::string &error) {
+    close();
+    this->error = error;
+    return false;
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+#include "shot_metrics.h"
+
+//
+// Searches test a whole block with a branch-free reduction the compiler can
+// vectorise, and only scan scalar inside the block that holds the answer.
+//
+
+#define SCAN_BLOCK 64
+
+int16_t findMax(const int16_t *values, size_t count) {
+    int16_t peak = INT16_MIN;
+#pragma omp simd reduction(max : peak)
+    for (size_t i = 0; i < count; i++) {
+        peak = std::max(peak, values[i]);
+    }
+    return peak;
+}
+
+static bool anyAtLeast(const int16_t *values, size_t count, int16_t threshold) {
+    int hit = 0;
+#pragma omp simd reduction(| : hit)
+    for (size_t i = 0; i < count; i++) {
+        hit |= values[i] >= threshold;
+    }
+    return hit != 0;
+}
+
+size_t findFirstAtLeast(const int16_t *values, size_t count, int16_t threshold) {
+    for (size_t block = 0; block < count; block += SCAN_BLOCK) {
+        size_t length = std::min<size_t>(SCAN_BLOCK, count - block);
+        if (!anyAtLeast(values + block, length, threshold)) {
+            continue;
+        }
+        for (size_t i = block; i < block + length; i++) {
+            if (values[i] >= threshold) {
+                return i;
+            }
+        }
+    }
+    return count;
+}
+
+size_t findLastAtLeast(const int16_t *values, size_t count, int16_t threshold) {
+    for (size_t end = count; end > 0;) {
+        size_t length = std::min<size_t>(SCAN_BLOCK, end);
+        size_t block = end - length;
+        if (anyAtLeast(values + block, length, threshold)) {
+            for (size_t i = end; i > block; i--) {
+                if (values[i - 1] >= threshold) {
+                    return i - 1;
+                }
+            }
+        }
+        end = block;
+    }
+    return count;
+}
+
+static int16_t fractionOf(int16_t value, int percent) {
+    return int16_t(int32_t(value) * percent / 100);
+}
+
+ShotMetrics computeShotMetrics(const ShotFileView &shot, uint8_t channel) {
+    ShotMetrics metrics = {};
+    const uint32_t *times = shot.getTimes();
+    const int16_t *values = shot.getChannel(channel);
+    size_t count = shot.getSampleCount();
+    metrics.sampleCount = uint32_t(count);
+    if (values == nullptr || count == 0) {
+        return metrics;
+    }
+
+    int16_t peak = findMax(values, count);
+    if (peak < SHOT_END_PRESSURE) {
+        return metrics;
+    }
+    metrics.valid = true;
+    metrics.peakPressure = peak;
+    metrics.timeToPeak = times[findFirstAtLeast(values, count, peak)];
+
+    size_t last = findLastAtLeast(values, count, SHOT_END_PRESSURE);
+    metrics.duration = times[last] - times[0];
+
+    size_t rampStart = findFirstAtLeast(values, count, fractionOf(peak, 10));
+    size_t rampEnd = findFirstAtLeast(values, count, fractionOf(peak, 90));
+    metrics.rampTime = times[rampEnd] - times[rampStart];
+
+    // Plateau: from reaching 90% of peak until pressure finally drops below
+    // 80%. Dips inside it are kept, they are what the deviation measures
+    size_t plateauEnd = findLastAtLeast(values, count, fractionOf(peak, 80));
+    if (plateauEnd <= rampEnd) {
+        return metrics;
+    }
+    metrics.plateauTime = times[plateauEnd] - times[rampEnd];
+
+    const int16_t *plateau = values + rampEnd;
+    size_t length = plateauEnd - rampEnd + 1;
+    int64_t sum = 0;
+#pragma omp simd reduction(+ : sum)
+    for (size_t i = 0; i < length; i++) {
+        sum += plateau[i];
+    }
+    double mean = double(sum) / double(length);
+
+    // Second pass around the mean: the spread is tens of mbar on a ~9000
+    // mbar plateau, too small to survive E[x^2] - E[x]^2
+    double squares = 0;
+#pragma omp simd reduction(+ : squares)
+    for (size_t i = 0; i < length; i++) {
+        double deviation = plateau[i] - mean;
+        squares += deviation * deviation;
+    }
+
+    metrics.plateauMean = int16_t(std::lround(mean));
+    metrics.plateauStdDev = float(std::sqrt(squares / double(length)));
+    return metrics;
+}
@@ -0,0 +1,163 @@
+#include <chrono>
+#include "thread_pool.h"
+
+// Index of the pool worker running on this thread, or -1 off the pool
+static thread_local const ThreadPool *currentPool = nullptr;
+static thread_local int currentWorker = -1;
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+
+    for (unsigned i = 0; i < threadCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+unsigned ThreadPool::size() const {
+    return unsigned(workers.size());
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    pending.fetch_add(1);
+    push(std::move(task));
+}
+
+void ThreadPool::wait() {
+    while (pending.load() > 0) {
+        if (runOne()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        idle.wait_for(lock, std::chrono::milliseconds(1), [this] { return pending.load() == 0; });
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &body, size_t grain) {
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+
+    // Completion is tracked per call rather than with the pool-wide
+    // counter, which would include the task a nested call is running in
+    size_t chunks = (count + grain - 1) / grain;
+    auto remaining = std::make_shared<std::atomic<size_t>>(chunks);
+
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        size_t begin = chunk * grain;
+        size_t end = std::min(begin + grain, count);
+        submit([&body, begin, end, remaining] {
+            for (size_t i = begin; i < end; i++) {
+                body(i);
+            }
+            remaining->fetch_sub(1);
+        });
+    }
+
+    while (remaining->load() > 0) {
+        if (!runOne()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ThreadPool::push(std::function<void()> task) {
+    // A worker keeps what it spawns; outside threads deal round-robin
+    unsigned index = currentPool == this && currentWorker >= 0
+        ? unsigned(currentWorker)
+        : nextWorker.fetch_add(1) % size();
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1);
+
+    // Taking the lock orders this against a worker that has just checked
+    // queued and is about to sleep
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wake.notify_one();
+}
+
+bool ThreadPool::popLocal(unsigned index, std::function<void()> &task) {
+    Worker &worker = *workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    queued.fetch_sub(1);
+    return true;
+}
+
+bool ThreadPool::steal(unsigned thief, std::function<void()> &task) {
+    unsigned count = size();
+    for (unsigned offset = 1; offset <= count; offset++) {
+        Worker &victim = *workers[(thief + offset) % count];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty()) {
+            continue;
+        }
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::runOne() {
+    std::function<void()> task;
+    bool found = currentPool == this && currentWorker >= 0
+        ? popLocal(unsigned(currentWorker), task) || steal(unsigned(currentWorker), task)
+        : steal(nextWorker.load() % size(), task);
+    if (!found) {
+        return false;
+    }
+
+    task();
+    if (pending.fetch_sub(1) == 1) {
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        idle.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::run(unsigned index) {
+    currentPool = this;
+    currentWorker = int(index);
+
+    while (true) {
+        if (runOne()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping.load() || queued.load() > 0; });
+        if (stopping.load() && queued.load() == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+
+//
+// Minimal assertions shared by the host tests: a failed check is reported
+// and counted, the test keeps going and main() returns non-zero at the end
+//
+
+inline int failures = 0;
+
+#define CHECK(condition)                                                    \
+    do {                                                                    \
+        if (!(condition)) {                                                 \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                          \
+    do {                                                                    \
+        long long a = (long long) (actual);                                 \
+        long long e = (long long) (expected);                               \
+        if (a != e) {                                                       \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, a, e); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
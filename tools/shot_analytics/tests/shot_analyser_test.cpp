@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "shot_analyser.h"
+#include "check.h"
+
+//
+// Host tests for the firmware's streaming ShotAnalyser. Pressure profiles
+// are fed at the firmware's default 20 ms sample period; every sample is
+// followed by the same checks loop() would make.
+//
+
+#define PERIOD_MS 20
+
+struct Feed {
+    ShotAnalyser analyser;
+    uint32_t now = 1000;
+    int16_t pressure = 0;
+    uint32_t starts = 0;
+    std::vector<ShotSummary> summaries;
+    std::vector<ShotPhase> phases;   // every phase change, in order
+    uint32_t warnings = 0;           // samples with the warning on
+
+    void sample(int16_t value) {
+        now += PERIOD_MS;
+        pressure = value;
+        bool wasRunning = analyser.isShotRunning();
+        ShotPhase phase = analyser.getPhase();
+
+        analyser.update(value, now);
+
+        if (!wasRunning && analyser.isShotRunning()) {
+            starts++;
+        }
+        if (analyser.getPhase() != phase) {
+            phases.push_back(analyser.getPhase());
+        }
+        if (analyser.isOverPressureWarning()) {
+            warnings++;
+        }
+        ShotSummary summary;
+        if (analyser.takeSummary(summary)) {
+            summaries.push_back(summary);
+        }
+    }
+
+    void hold(int16_t value, uint32_t ms) {
+        for (uint32_t t = 0; t < ms; t += PERIOD_MS) {
+            sample(value);
+        }
+    }
+
+    // Linear change to target at rate mbar/s, ending on the target
+    void ramp(int16_t target, int32_t rate) {
+        int32_t step = rate * PERIOD_MS / 1000;
+        int32_t value = pressure;
+        while (value != target) {
+            value = value < target ? std::min<int32_t>(value + step, target) : std::max<int32_t>(value - step, target);
+            sample(int16_t(value));
+        }
+    }
+
+    // Plateau with +-amplitude square-wave noise, the kind a pump puts on it
+    void noisy(int16_t value, int16_t amplitude, uint32_t ms) {
+        for (uint32_t t = 0; t < ms; t += PERIOD_MS) {
+            sample(int16_t((t / PERIOD_MS) % 2 == 0 ? value + amplitude : value - amplitude));
+        }
+    }
+};
+
+static bool contains(const std::vector<ShotPhase> &phases, ShotPhase phase) {
+    for (ShotPhase p : phases) {
+        if (p == phase) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A typical shot: rise at 10 bar/s to a 9 bar plateau, then the pump stops
+// and pressure vents to zero
+static void brew(Feed &feed, uint32_t plateauMs = 20000) {
+    feed.ramp(9000, 10000);
+    feed.noisy(9000, 100, plateauMs);
+    feed.ramp(0, 40000);
+}
+
+static void testStartFromRest() {
+    Feed feed;
+    feed.hold(0, 2000);
+    uint32_t rise = feed.now;  // last sample at rest
+    brew(feed);
+    feed.hold(0, 1000);
+
+    CHECK_EQ(feed.starts, 1);
+    CHECK_EQ(feed.summaries.size(), 1);
+    if (feed.summaries.size() == 1) {
+        const ShotSummary &summary = feed.summaries[0];
+        // Back-dated to the rise, give or take the slope filter's lag
+        CHECK(summary.startTime >= rise && summary.startTime <= rise + 5 * PERIOD_MS);
+        CHECK(summary.peakPressure >= 9000 && summary.peakPressure <= 9100);
+        CHECK(summary.timeToPeak >= 900 && summary.timeToPeak <= 1100);
+        CHECK(summary.plateauMean >= 8950 && summary.plateauMean <= 9050);
+        CHECK(summary.plateauTime >= 19000 && summary.plateauTime <= 20500);
+        // 0.9 s ramp, 20 s plateau, then about 0.2 s down to END_PRESSURE
+        CHECK(summary.duration >= 20900 && summary.duration <= 21400);
+    }
+}
+
+// Residual pressure above REST_PRESSURE for a minute must not hold the
+// start time back to the end of the previous shot
+static void testStartFromResidual() {
+    Feed feed;
+    feed.hold(300, 60000);
+    uint32_t rise = feed.now;
+    brew(feed);
+    feed.hold(0, 1000);
+
+    CHECK_EQ(feed.starts, 1);
+    CHECK(feed.analyser.getShotStartTime() >= rise);
+    CHECK(feed.analyser.getShotStartTime() <= rise + 5 * PERIOD_MS);
+}
+
+// Ramp in, plateau out, decline on the drop. The noisy plateau must not
+// flicker between phases
+static void testPhaseHysteresis() {
+    Feed feed;
+    feed.hold(0, 1000);
+    feed.ramp(9000, 10000);
+    CHECK(contains(feed.phases, SHOT_RAMP));
+
+    feed.noisy(9000, 150, 1000);
+    CHECK_EQ(feed.analyser.getPhase(), SHOT_PLATEAU);
+    size_t changes = feed.phases.size();
+    feed.noisy(9000, 150, 15000);
+    CHECK_EQ(feed.phases.size(), changes);
+
+    // A slow decline through the plateau is still decline
+    feed.ramp(4000, 4000);
+    CHECK_EQ(feed.analyser.getPhase(), SHOT_DECLINE);
+}
+
+// Pre-infusion held flat at 2 bar is part of the shot, not its end
+static void testPreinfusionHold() {
+    Feed feed;
+    feed.hold(0, 1000);
+    feed.ramp(2000, 10000);
+    feed.hold(2000, 6000);
+    CHECK(feed.analyser.isShotRunning());
+    CHECK_EQ(feed.analyser.getPhase(), SHOT_PREINFUSION);
+
+    feed.ramp(9000, 10000);
+    feed.noisy(9000, 100, 10000);
+    feed.ramp(0, 40000);
+    feed.hold(0, 1000);
+    CHECK_EQ(feed.starts, 1);
+    CHECK_EQ(feed.summaries.size(), 1);
+}
+
+static void testEndAtZero() {
+    Feed feed;
+    feed.hold(0, 1000);
+    brew(feed);
+    uint32_t vented = feed.now;
+    feed.hold(0, 2000);
+
+    CHECK(!feed.analyser.isShotRunning());
+    CHECK_EQ(feed.summaries.size(), 1);
+    // END_HOLD_MS after pressure left END_PRESSURE
+    CHECK(feed.analyser.getLastSummary().startTime + feed.analyser.getLastSummary().duration <= vented);
+}
+
+// Machines that keep 0.5-1 bar after the shot: above END_PRESSURE, below
+// the 1 bar start pressure. The shot has to end anyway, once, and the
+// residual must not start another one
+static void testEndOnResidual() {
+    Feed feed;
+    feed.hold(0, 1000);
+    feed.ramp(9000, 10000);
+    feed.noisy(9000, 100, 20000);
+    feed.ramp(700, 40000);
+    uint32_t settled = feed.now;
+    feed.hold(700, 3000);
+
+    CHECK(!feed.analyser.isShotRunning());
+    CHECK_EQ(feed.summaries.size(), 1);
+    if (feed.summaries.size() == 1) {
+        const ShotSummary &summary = feed.summaries[0];
+        uint32_t end = summary.startTime + summary.duration;
+        // Ends where pressure fell under the start pressure, not a second later
+        CHECK(end <= settled && end + 500 >= settled);
+    }
+
+    // Residual with a slight creep, as a cooling boiler gives
+    for (int i = 0; i < 60; i++) {
+        feed.hold(int16_t(700 + i), 1000);
+    }
+    CHECK_EQ(feed.starts, 1);
+    CHECK_EQ(feed.summaries.size(), 1);
+
+    // The next shot from that residual still starts and ends
+    brew(feed);
+    feed.hold(700, 3000);
+    CHECK_EQ(feed.starts, 2);
+    CHECK_EQ(feed.summaries.size(), 2);
+}
+
+// The start setting is a threshold too: a slow pre-infusion that never
+// shows a clear rise starts the shot once it crosses it
+static void testStartPressureSetting() {
+    Feed feed;
+    feed.analyser.setStartPressure(2000);
+    feed.hold(0, 1000);
+    feed.ramp(1500, 1000);   // below START_SLOPE
+    feed.hold(1500, 2000);
+    CHECK(!feed.analyser.isShotRunning());
+    feed.ramp(2100, 1000);
+    CHECK(feed.analyser.isShotRunning());
+}
+
+static void testWarning() {
+    // A normal 9 bar shot stays clear of a 12 bar limit
+    Feed normal;
+    normal.analyser.setWarnPressure(12000);
+    normal.hold(0, 1000);
+    brew(normal);
+    CHECK_EQ(normal.warnings, 0);
+
+    // A ramp heading past the limit warns before it gets there
+    Feed over;
+    over.analyser.setWarnPressure(12000);
+    over.analyser.setWarnHorizon(1000);
+    over.hold(0, 1000);
+    over.ramp(11000, 10000);
+    CHECK(over.analyser.isOverPressureWarning());
+
+    over.ramp(13000, 5000);
+    over.hold(13000, 1000);
+    CHECK(over.analyser.isOverPressureWarning());
+
+    // Released once pressure is back well under the limit and the hold ran out
+    over.ramp(9000, 20000);
+    over.hold(9000, 2000);
+    CHECK(!over.analyser.isOverPressureWarning());
+}
+
+int main() {
+    testStartFromRest();
+    testStartFromResidual();
+    testPhaseHysteresis();
+    testPreinfusionHold();
+    testEndAtZero();
+    testEndOnResidual();
+    testStartPressureSetting();
+    testWarning();
+
+    if (failures != 0) {
+        printf("shot analyser: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("shot analyser: all checks passed\n");
+    return 0;
+}
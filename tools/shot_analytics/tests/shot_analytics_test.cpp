@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "shot_curves.h"
+#include "shot_file_view.h"
+#include "shot_metrics.h"
+#include "thread_pool.h"
+#include "check.h"
+
+//
+// Host tests for the shot analytics library. Every case writes synthetic
+// shot files to a scratch directory and checks the library against values
+// known by construction or recomputed the slow, obvious way.
+//
+
+namespace fs = std::filesystem;
+
+struct SyntheticShot {
+    int16_t grinderSetting = SHOT_FILE_GRINDER_UNKNOWN;
+    std::vector<uint32_t> times;
+    std::vector<std::vector<int16_t>> channels;
+};
+
+static ShotFileHeader makeHeader(const SyntheticShot &shot) {
+    ShotFileHeader header = {};
+    header.magic = SHOT_FILE_MAGIC;
+    header.version = SHOT_FILE_VERSION;
+    header.headerSize = sizeof(ShotFileHeader);
+    header.channelCount = uint8_t(shot.channels.size());
+    header.samplePeriodMs = 20;
+    header.grinderSetting = shot.grinderSetting;
+    header.sampleCount = uint32_t(shot.times.size());
+    return header;
+}
+
+// Writes the header as given and then as many sample bytes as the shot has,
+// so a test can make the two disagree
+static void writeFile(const fs::path &path, const ShotFileHeader &header, const SyntheticShot &shot) {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        perror(path.c_str());
+        exit(1);
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(shot.times.data(), sizeof(uint32_t), shot.times.size(), file);
+    for (const auto &channel : shot.channels) {
+        fwrite(channel.data(), sizeof(int16_t), channel.size(), file);
+    }
+    fclose(file);
+}
+
+static void writeShot(const fs::path &path, const SyntheticShot &shot) {
+    writeFile(path, makeHeader(shot), shot);
+}
+
+//
+// Metrics
+//
+
+// 20 ms samples: rest, a linear ramp to 7200, a jump to the 9000 peak, a
+// plateau alternating 9000/8800, then rest again. The rest tail is long
+// enough that the backwards searches cross several scan blocks.
+static void testMetrics(const fs::path &dir) {
+    SyntheticShot shot;
+    shot.channels.resize(2);
+    for (uint32_t i = 0; i < 1000; i++) {
+        int16_t value = 0;
+        if (i >= 10 && i < 18) {
+            value = int16_t(900 * (i - 9));
+        } else if (i >= 18 && i < 150) {
+            value = i % 2 == 0 ? 9000 : 8800;
+        }
+        shot.times.push_back(i * 20);
+        shot.channels[0].push_back(value);
+        shot.channels[1].push_back(int16_t(-value));
+    }
+    fs::path path = dir / "metrics.mxs";
+    writeShot(path, shot);
+
+    ShotFileView view;
+    CHECK(view.open(path.string()));
+    CHECK_EQ(view.getSampleCount(), 1000);
+    CHECK_EQ(view.getChannelCount(), 2);
+    CHECK_EQ(view.getChannel(1)[20], -9000);
+
+    ShotMetrics metrics = computeShotMetrics(view);
+    CHECK(metrics.valid);
+    CHECK_EQ(metrics.peakPressure, 9000);
+    CHECK_EQ(metrics.timeToPeak, 18 * 20);
+    CHECK_EQ(metrics.duration, 149 * 20);
+    CHECK_EQ(metrics.rampTime, (18 - 10) * 20);     // 900 is 10%, 9000 the first at 90%
+    CHECK_EQ(metrics.plateauTime, (149 - 18) * 20);
+    CHECK_EQ(metrics.plateauMean, 8900);
+    CHECK(std::fabs(metrics.plateauStdDev - 100.0f) < 1e-3f);
+
+    // Nothing above the end threshold is not a shot
+    ShotMetrics rest = computeShotMetrics(view, 1);
+    CHECK(!rest.valid);
+}
+
+//
+// Percentile curves
+//
+
+// Straight from the definition: sample-and-hold onto the bin grid, sort the
+// column, interpolate between closest ranks
+static std::vector<int16_t> bruteForceColumn(const std::vector<SyntheticShot> &shots, int16_t grinder, uint32_t t) {
+    std::vector<int16_t> column;
+    for (const auto &shot : shots) {
+        if (shot.grinderSetting != grinder || t > shot.times.back()) {
+            continue;
+        }
+        size_t sample = 0;
+        for (size_t i = 0; i < shot.times.size(); i++) {
+            if (shot.times[i] <= t) {
+                sample = i;
+            }
+        }
+        column.push_back(shot.channels[0][sample]);
+    }
+    std::sort(column.begin(), column.end());
+    return column;
+}
+
+static int16_t bruteForcePercentile(const std::vector<int16_t> &sorted, double p) {
+    double rank = p / 100.0 * double(sorted.size() - 1);
+    size_t lower = size_t(std::floor(rank));
+    size_t upper = std::min(lower + 1, sorted.size() - 1);
+    return int16_t(std::lround(sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - double(lower))));
+}
+
+static void testPercentiles(const fs::path &dir) {
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int> length(20, 400);
+    std::uniform_int_distribution<int> jitter(15, 25);
+    std::uniform_int_distribution<int> pressure(0, 12000);
+
+    const int16_t grinders[] = { 7, 12, SHOT_FILE_GRINDER_UNKNOWN };
+    std::vector<SyntheticShot> shots(61);
+    for (size_t i = 0; i < shots.size(); i++) {
+        SyntheticShot &shot = shots[i];
+        shot.grinderSetting = grinders[i % 3];
+        shot.channels.resize(1);
+        uint32_t time = 0;
+        for (int n = length(random); n > 0; n--) {
+            shot.times.push_back(time);
+            shot.channels[0].push_back(int16_t(pressure(random)));
+            time += jitter(random);
+        }
+        writeShot(dir / ("curve" + std::to_string(i) + ".mxs"), shot);
+    }
+
+    std::vector<ShotFileView> views(shots.size());
+    std::vector<const ShotFileView *> pointers;
+    for (size_t i = 0; i < shots.size(); i++) {
+        CHECK(views[i].open((dir / ("curve" + std::to_string(i) + ".mxs")).string()));
+        pointers.push_back(&views[i]);
+    }
+
+    CurveOptions options;
+    options.binMs = 50;
+    options.maxMs = 20000;
+    options.percentiles = { 0, 10, 33.3, 50, 90, 100 };
+
+    ThreadPool pool(4);
+    std::vector<PercentileCurve> curves = computePercentileCurves(pointers, options, pool);
+    CHECK_EQ(curves.size(), 3);
+
+    for (const auto &curve : curves) {
+        CHECK_EQ(curve.shotCount, 20 + (curve.grinderSetting == 7 ? 1 : 0));
+        CHECK(!curve.binShots.empty());
+        for (size_t bin = 0; bin < curve.binShots.size(); bin++) {
+            std::vector<int16_t> column = bruteForceColumn(shots, curve.grinderSetting, uint32_t(bin) * options.binMs);
+            CHECK_EQ(curve.binShots[bin], column.size());
+            if (column.empty()) {
+                continue;
+            }
+            for (size_t p = 0; p < options.percentiles.size(); p++) {
+                CHECK_EQ(curve.values[p][bin], bruteForcePercentile(column, options.percentiles[p]));
+            }
+        }
+    }
+}
+
+//
+// Malformed files
+//
+
+static void expectRejected(const fs::path &path, const char *what) {
+    ShotFileView view;
+    if (view.open(path.string())) {
+        fprintf(stderr, "%s: opened, expected rejection\n", what);
+        failures++;
+        return;
+    }
+    CHECK(!view.isOpen());
+    CHECK(!view.getError().empty());
+}
+
+static void testRejection(const fs::path &dir) {
+    SyntheticShot shot;
+    shot.channels.resize(1);
+    for (uint32_t i = 0; i < 100; i++) {
+        shot.times.push_back(i * 20);
+        shot.channels[0].push_back(int16_t(i * 100));
+    }
+
+    ShotFileHeader header = makeHeader(shot);
+    header.sampleCount++;
+    writeFile(dir / "truncated.mxs", header, shot);
+    expectRejected(dir / "truncated.mxs", "truncated");
+
+    header = makeHeader(shot);
+    header.magic ^= 1;
+    writeFile(dir / "magic.mxs", header, shot);
+    expectRejected(dir / "magic.mxs", "bad magic");
+
+    header = makeHeader(shot);
+    header.version = SHOT_FILE_VERSION + 1;
+    writeFile(dir / "version.mxs", header, shot);
+    expectRejected(dir / "version.mxs", "bad version");
+
+    header.version = 0;
+    writeFile(dir / "version0.mxs", header, shot);
+    expectRejected(dir / "version0.mxs", "version 0");
+
+    // Version 1 files predate shotNumber and still read
+    header.version = 1;
+    writeFile(dir / "version1.mxs", header, shot);
+    ShotFileView old;
+    CHECK(old.open((dir / "version1.mxs").string()));
+
+    FILE *file = fopen((dir / "short.mxs").c_str(), "wb");
+    fwrite(&header, sizeof(header) / 2, 1, file);
+    fclose(file);
+    expectRejected(dir / "short.mxs", "shorter than a header");
+
+    expectRejected(dir / "missing.mxs", "missing");
+
+    // The well-formed original still opens
+    writeShot(dir / "good.mxs", shot);
+    ShotFileView view;
+    CHECK(view.open((dir / "good.mxs").string()));
+}
+
+//
+// Thread pool
+//
+
+// Tasks that fan out again must not deadlock, even with a single worker,
+// because the waiting caller runs queued work itself
+static void testNestedParallelFor() {
+    for (unsigned threads : { 1u, 4u }) {
+        ThreadPool pool(threads);
+        const size_t outer = 16;
+        const size_t inner = 1000;
+        std::vector<std::atomic<uint64_t>> sums(outer);
+        for (auto &sum : sums) {
+            sum = 0;
+        }
+
+        for (size_t task = 0; task < outer; task++) {
+            pool.submit([&, task] {
+                pool.parallelFor(inner, [&, task](size_t i) {
+                    sums[task] += i + 1;
+                }, 7);
+            });
+        }
+        pool.wait();
+        for (size_t task = 0; task < outer; task++) {
+            CHECK_EQ(sums[task].load(), inner * (inner + 1) / 2);
+        }
+
+        // parallelFor inside parallelFor
+        std::atomic<uint64_t> total{0};
+        pool.parallelFor(outer, [&](size_t) {
+            pool.parallelFor(inner, [&](size_t i) {
+                total += i;
+            });
+        });
+        CHECK_EQ(total.load(), outer * inner * (inner - 1) / 2);
+    }
+}
+
+int main() {
+    fs::path dir = fs::temp_directory_path() / ("shot_analytics_test_" + std::to_string(std::random_device()()));
+    fs::create_directories(dir);
+
+    testMetrics(dir);
+    testPercentiles(dir);
+    testRejection(dir);
+    testNestedParallelFor();
+
+    fs::remove_all(dir);
+
+    if (failures != 0) {
+        printf("shot analytics: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("shot analytics: all checks passed\n");
+    return 0;
+}